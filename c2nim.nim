@@ -9,9 +9,9 @@
 
 import std / [strutils, os, osproc, times, md5, parseopt, strscans, sequtils, tables]
 
-import compiler/ [llstream, ast, renderer, options, msgs, nversion]
+import compiler/ [llstream, ast, idents, renderer, options, msgs, nversion]
 
-import clexer, cparser, postprocessor
+import clexer, cparser, postprocessor, tracing
 
 when declared(NimCompilerApiVersion):
   import compiler / [lineinfos, pathutils]
@@ -74,9 +74,33 @@ Options:
   --mergeDuplicates      merge similar adjacent blocks like two let sections
   --ignoreRValueRefs     translate C++'s ``T&&`` to ``T`` instead ``of var T``
   --keepBodies           keep C++'s method bodies
+  --typeTable            record the defined type names and use them to tell
+                         declarations from expressions in function bodies
+  --knownType:NAME       add NAME to the known types of --typeTable, e.g. a
+                         type of another header
   --cppBindStatic        bind cpp methods to their types
   --concat               concat the list of files into a single .nim file
   --concat:all           concat the list of files including c2nim files
+  --stream               parse, post process and render one declaration at a
+                         time to keep the memory use flat for huge inputs;
+                         ignored for --concat, --exportdll and the options
+                         that reorder or merge declarations
+  --split:SIZE           split output files that would be larger than SIZE
+                         KB into modules that import their predecessor and
+                         an umbrella module that exports all of them;
+                         symbols that are not exported are not visible in
+                         the later modules
+  --parallel[:N]         parse, post process and render large C files on N
+                         threads (default: number of processors); needs
+                         --threads:on --mm:atomicArc when building c2nim;
+                         keeps the output of a file in memory until it is
+                         written
+  --profile:backtrack    write the parser rules and input lines that cause
+                         the most backtracking to stdout
+  --trace:FILE           write a timeline of the files, phases and top level
+                         declarations to FILE (Chrome's trace event format)
+  --stats                write the number of tokens, backtracking steps,
+                         the peak memory and the times to stdout
   --debug                prints a c2nim stack trace in case of an error
   --exportdll:PREFIX     produce a DLL wrapping the C++ code
   --render:OPT           various render options. See c2nim.rst for more docs
@@ -90,6 +114,18 @@ proc isCppFile(s: string): bool =
 when not declared(NimCompilerApiVersion):
   type AbsoluteFile = string
 
+type
+  Phase = enum
+    phParse = "parse", phPostprocess = "postprocess", phRender = "render"
+
+var phaseTimes: array[Phase, float] # in seconds; for --stats and --trace
+
+template timed(ph: Phase; body: untyped) =
+  let t0 = epochTime()
+  traced($ph, "phase"):
+    body
+  phaseTimes[ph] += epochTime() - t0
+
 proc parse(infile: string, options: PParserOptions; dllExport: var PNode): PNode =
   var stream = llStreamOpen(AbsoluteFile infile, fmRead)
   if stream == nil:
@@ -100,9 +136,16 @@ proc parse(infile: string, options: PParserOptions; dllExport: var PNode): PNode
   let isCpp = pfCpp notin options.flags and isCppFile(infile)
   var p: Parser
   if isCpp: options.flags.incl pfCpp
-  openParser(p, infile, stream, options)
-  result = parseUnit(p).postprocess(options.flags, options.deletes)
-  closeParser(p)
+  timed phParse:
+    if stream != nil: result = parseRegions(infile, options)
+    if result.isNil:
+      openParser(p, infile, stream, options)
+      result = parseUnit(p)
+      closeParser(p)
+    else:
+      llStreamClose(stream)
+  timed phPostprocess:
+    result = result.postprocess(options.flags, options.deletes, options.workers)
   if isCpp: options.flags.excl pfCpp
   if options.exportPrefix.len > 0:
     let dllprocs = exportAsDll(result, options.exportPrefix)
@@ -114,8 +157,18 @@ proc parse(infile: string, options: PParserOptions; dllExport: var PNode): PNode
 
 proc isC2nimFile(s: string): bool = splitFile(s).ext.toLowerAscii == ".c2nim"
 
+const
+  WholeFileFlags = {pfReorderTypes, pfMergeBlocks, pfMergeDuplicates,
+                    pfReorderComments, pfStructStruct}
+    ## post processing steps that look at more than one declaration
+
+proc canStream(options: PParserOptions): bool =
+  WholeFileFlags * options.flags == {} and options.exportPrefix.len == 0
+
 proc parseDefines(val: string): seq[ref Token] =
-  let tpath = getTempDir() / "macro_" & getMD5(val) & ".h"
+  # per process: the tests run several c2nims with the same --def at once
+  let tpath = getTempDir() / "macro_" & $getCurrentProcessId() & "_" &
+              getMD5(val) & ".h"
   let tfl = (open(tpath, fmReadWrite), tpath)
   let ss = llStreamOpen(val)
   var lex: Lexer
@@ -147,48 +200,144 @@ proc parseDefineArgs(parserOptions: var PParserOptions, val: string) =
     if m.xkind == pxSymbol: inc mc.params
   parserOptions.macros.add(mc)
 
-var dummy: PNode
-
-when not compiles(renderModule(dummy, "")):
-  # newer versions of 'renderModule' take 2 parameters. We workaround this
-  # problem here:
-  proc renderModule(tree: PNode; filename: string, renderFlags: TRenderFlags) =
-    renderModule(tree, filename, filename, renderFlags)
+proc writeTrimmed(f: File; b: string; spaces: var int) =
+  # writes `b` without trailing whitespace. `spaces` counts the spaces at
+  # the end of the previous chunk that are not yet known to be trailing:
+  var o = newStringOfCap(b.len + spaces)
+  for ch in b:
+    case ch
+    of ' ':
+      inc spaces
+    of '\L':
+      spaces = 0
+      o.add '\L'
+    else:
+      for i in 1..spaces: o.add ' '
+      spaces = 0
+      o.add ch
+  f.write(o)
 
-proc myRenderModule(tree: PNode; filename: string, renderFlags: TRenderFlags) =
+proc myRenderModule(tree: PNode; filename: string, renderFlags: TRenderFlags;
+                    threads = 1) =
   # also ensure we produced no trailing whitespace:
-  let tmpFile = filename & ".tmp"
-  renderModule(tree, tmpFile, renderFlags)
+  var spaces = 0
+  let f = open(filename, fmWrite)
+  var g: TSrcGen
+  initModuleRender(g, renderFlags)
+  setSink(g, proc (s: string) = writeTrimmed(f, s, spaces))
+  renderStatements(g, tree, threads)
+  finishModule(g)
+  for i in 1..spaces: f.write(' ')
+  f.close
+
+proc moduleStmt(kind: TNodeKind; name: string): PNode =
+  result = newNode(kind)
+  var m = newNode(nkIdent)
+  when declared(NimCompilerApiVersion):
+    m.ident = getIdent(identCache, name)
+  else:
+    m.ident = getIdent(name)
+  result.add m
 
-  let b = readFile(tmpFile)
-  removeFile(tmpFile)
-  let L = b.len
+proc renderParts(tree: PNode; filename: string, renderFlags: TRenderFlags;
+                 maxSize: int) =
+  ## like 'myRenderModule', but starts a new module whenever the current
+  ## one exceeds `maxSize` bytes. The split happens between top level
+  ## statements only, so a type section is never torn apart. As C declares
+  ## everything before its use, every part only needs the parts before it:
+  ## it imports and re-exports its predecessor. `filename` becomes the
+  ## umbrella module that exports all parts.
+  let (path, name, ext) = filename.splitFile
+  var parts: seq[string] = @[]
+  var f: File
+  var spaces, written = 0
+  var g: TSrcGen
   var i = 0
-  let f = open(filename, fmWrite)
-  while i < L:
-    let ch = b[i]
-    if ch > ' ':
-      f.write(ch)
-    elif ch == ' ':
-      let j = i
-      while i < L and b[i] == ' ': inc i
-      if i < L and b[i] == '\L':
-        f.write('\L')
-      else:
-        for ii in j..i-1:
-          f.write(' ')
-        dec i
-    elif ch == '\L':
-      f.write('\L')
+  while i < sonsLen(tree):
+    let part = name & "_part" & $(parts.len + 1)
+    f = open(path / part & ext, fmWrite)
+    spaces = 0
+    written = 0
+    initModuleRender(g, renderFlags)
+    let sink = proc (s: string) =
+      inc written, s.len
+      writeTrimmed(f, s, spaces)
+    setSink(g, sink, min(64 * 1024, maxSize div 4 + 1))
+    if parts.len > 0:
+      renderTopLevel(g, moduleStmt(nkImportStmt, parts[^1]))
+      renderTopLevel(g, moduleStmt(nkExportStmt, parts[^1]))
+    # at least one statement per part:
+    renderTopLevel(g, tree[i])
+    inc i
+    while i < sonsLen(tree) and written < maxSize:
+      renderTopLevel(g, tree[i])
+      inc i
+    finishModule(g)
+    for k in 1..spaces: f.write(' ')
+    f.close
+    parts.add part
+  if parts.len <= 1:
+    if parts.len == 1: moveFile(path / parts[0] & ext, filename)
+    else: myRenderModule(tree, filename, renderFlags)
+    return
+  var umbrella = newNode(nkStmtList)
+  for part in parts: umbrella.add moduleStmt(nkImportStmt, part)
+  for part in parts: umbrella.add moduleStmt(nkExportStmt, part)
+  myRenderModule(umbrella, filename, renderFlags)
+
+proc renderOutput(tree: PNode; filename: string; options: PParserOptions;
+                  splitSize: int) =
+  timed phRender:
+    if splitSize > 0:
+      renderParts(tree, filename, options.renderFlags, splitSize)
+    else:
+      myRenderModule(tree, filename, options.renderFlags, options.workers)
+
+proc streamFile(infile, outfile: string; options: PParserOptions) =
+  ## like 'parse' followed by 'myRenderModule', but every top level
+  ## statement is post processed and written out as soon as it is parsed.
+  var stream = llStreamOpen(AbsoluteFile infile, fmRead)
+  if stream == nil:
+    when declared(NimCompilerApiVersion):
+      rawMessage(gConfig, errGenerated, "cannot open file: " & infile)
     else:
-      f.write(ch)
-    inc(i)
+      rawMessage(errGenerated, "cannot open file: " & infile)
+  let isCpp = pfCpp notin options.flags and isCppFile(infile)
+  if isCpp: options.flags.incl pfCpp
+  var c = initContext(options.flags, options.deletes)
+  var spaces = 0
+  let f = open(outfile, fmWrite)
+  var g: TSrcGen
+  initModuleRender(g, options.renderFlags)
+  setSink(g, proc (s: string) = writeTrimmed(f, s, spaces))
+  var p: Parser
+  # the phases interleave; the time that is not spent on post processing
+  # and rendering a statement is the parser's:
+  let start = epochTime()
+  var rest = 0.0
+  openParser(p, infile, stream, options)
+  parseStatements(p, proc (n: PNode) =
+    let t0 = epochTime()
+    let list = postprocess(c, n)
+    let t1 = epochTime()
+    for x in list: renderTopLevel(g, x)
+    let t2 = epochTime()
+    phaseTimes[phPostprocess] += t1 - t0
+    phaseTimes[phRender] += t2 - t1
+    rest += t2 - t0)
+  closeParser(p)
+  let t0 = epochTime()
+  finishModule(g)
+  for i in 1..spaces: f.write(' ')
   f.close
+  phaseTimes[phRender] += epochTime() - t0
+  phaseTimes[phParse] += t0 - start - rest
+  if isCpp: options.flags.excl pfCpp
 
 proc main(infiles: seq[string],
           outfile: var string,
           options: PParserOptions,
-          concat: bool) =
+          concat, stream, stats: bool; splitSize: int; traceFile: string) =
   var start = getTime()
   var dllexport: PNode = nil
   var infiles = infiles
@@ -196,23 +345,33 @@ proc main(infiles: seq[string],
   if concat:
     var tree = newNode(nkStmtList)
     for infile in infiles:
-      let m = parse(infile.addFileExt("h"), options, dllexport)
+      var m: PNode
+      traced(infile, "file"):
+        m = parse(infile.addFileExt("h"), options, dllexport)
       if not isC2nimFile(infile):
         if outfile.len == 0:
           outfile = changeFileExt(infile, "nim")
       if not isC2nimFile(infile) or pfC2NimInclude in options.flags:
         for n in m: tree.add(n)
-    myRenderModule(tree, outfile, options.renderFlags)
+    renderOutput(tree, outfile, options, splitSize)
   else:
     for infile in infiles:
-      let m = parse(infile, options, dllexport)
-      if not isC2nimFile(infile):
-        if outfile.len > 0:
-          myRenderModule(m, outfile, options.renderFlags)
-          outfile = ""
-        else:
-          let outfile = changeFileExt(infile, "nim")
-          myRenderModule(m, outfile, options.renderFlags)
+      if stream and splitSize == 0 and not isC2nimFile(infile) and
+          canStream(options):
+        traced(infile, "file"):
+          streamFile(infile, if outfile.len > 0: outfile
+                             else: changeFileExt(infile, "nim"), options)
+        outfile = ""
+        continue
+      traced(infile, "file"):
+        let m = parse(infile, options, dllexport)
+        if not isC2nimFile(infile):
+          if outfile.len > 0:
+            renderOutput(m, outfile, options, splitSize)
+            outfile = ""
+          else:
+            let outfile = changeFileExt(infile, "nim")
+            renderOutput(m, outfile, options, splitSize)
   if dllexport != nil:
     let (path, name, _) = infiles[0].splitFile
     let outfile = path / name & "_dllimpl" & ".nim"
@@ -223,11 +382,26 @@ proc main(infiles: seq[string],
   else:
     rawMessage(hintSuccessX, [$gLinesCompiled, $(getTime() - start),
                               formatSize(getTotalMem()), ""])
+  if options.profileBacktracks: writeBacktrackProfile(stdout)
+  if traceFile.len > 0: writeTrace(traceFile)
+  if stats:
+    # one line for testsuite/perfgate.nim and testsuite/workload.nim:
+    stdout.write "stats: lines=", gLinesCompiled, " tokens=", gTokensLexed,
+      " backtracks=", gBacktracks, " maxmem=", getMaxMem(),
+      " time=", formatFloat(inMicroseconds(getTime() - start).float / 1e6,
+                            ffDecimal, 6)
+    for ph in Phase:
+      stdout.write " ", $ph, "=", formatFloat(phaseTimes[ph], ffDecimal, 6)
+    stdout.write "\n"
 
 var
   infiles = newSeq[string](0)
   outfile = ""
   concat = false
+  stream = false
+  stats = false
+  splitSize = 0
+  traceFile = ""
   parserOptions = newParserOptions()
 
 for kind, key, val in getopt():
@@ -250,6 +424,18 @@ for kind, key, val in getopt():
     of "spliceheader":
       quit "[Error] 'spliceheader' doesn't exist anymore" &
            " use a list of files and --concat instead"
+    of "stream": stream = true
+    of "stats": stats = true
+    of "trace":
+      traceFile = val
+      gTracing = true
+    of "profile":
+      if val.normalize == "backtrack": parserOptions.profileBacktracks = true
+      else: quit("[Error] unknown profile: " & val)
+    of "split": splitSize = parseInt(val) * 1024
+    of "parallel":
+      parserOptions.workers = if val.len > 0: parseInt(val)
+                              else: countProcessors()
     of "exportdll":
       parserOptions.exportPrefix = val
     of "def":
@@ -265,4 +451,5 @@ if infiles.len == 0:
   # no filename has been given, so we show the help:
   stdout.write(Usage)
 else:
-  main(infiles, outfile, parserOptions, concat)
+  main(infiles, outfile, parserOptions, concat, stream, stats, splitSize,
+       traceFile)
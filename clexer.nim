@@ -100,6 +100,11 @@ template correspondingOpenPar*(kind: Tokkind): Tokkind = pred(kind, 3)
 
 type
   NumericalBase* = enum base10, base2, base8, base16
+  AngleMatch* = enum          # cached classification of a '<' token
+    amUnknown,                # not yet classified
+    amNone,                   # not a template's angle bracket
+    amClose,                  # closed by 'closer'
+    amCloseSplit              # closed by the second half of the '>>' 'closer'
   Token* = object
     xkind*: Tokkind           # the type of the token
     s*: string                # parsed symbol, char, number or string literal
@@ -108,22 +113,35 @@ type
                               # or float literals
     next*: ref Token          # for C we need arbitrary look-ahead :-(
     lineNumber*: int          # line number
+    angle*: AngleMatch        # if xkind == pxLt: see isTemplateAngleBracket
+    closer*: ref Token        # the matching '>' if angle in {amClose..}
+    fromMacro*: bool          # produced by a macro expansion
 
   Lexer* = object of TBaseLexer
     fileIdx*: (when declared(FileIndex): FileIndex else: int32)
-    inDirective, debugMode*: bool
+    inDirective*, debugMode*: bool
+    tokens*: int              # number of tokens produced so far
+    quiet*: ref seq[tuple[info: TLineInfo, msg: TMsgKind, arg: string]]
+                              # if not nil: errors raise EQuietError, warnings
+                              # and hints are kept here
+
+  EQuietError* = object of CatchableError ## an error of a quiet lexer
 
 when not declared(OverflowDefect):
   type OverflowDefect = OverflowError
 
 var
   gLinesCompiled*: int
+  gTokensLexed*: int
 
 proc fillToken(L: var Token) =
   L.xkind = pxInvalid
   L.position = 0
   L.s = ""
   L.base = base10
+  L.angle = amUnknown
+  L.closer = nil
+  L.fromMacro = false
 
 when declared(NimCompilerApiVersion):
   var gConfig* = newConfigRef() # XXX make this part of the lexer
@@ -133,6 +151,7 @@ when declared(NimCompilerApiVersion):
 
 proc openLexer*(lex: var Lexer, filename: string, inputstream: PLLStream) =
   openBaseLexer(lex, inputstream)
+  lex.tokens = 0
   when declared(NimCompilerApiVersion):
     lex.fileIdx = fileInfoIdx(gConfig, AbsoluteFile filename)
   else:
@@ -140,6 +159,7 @@ proc openLexer*(lex: var Lexer, filename: string, inputstream: PLLStream) =
 
 proc closeLexer*(lex: var Lexer) =
   inc(gLinesCompiled, lex.lineNumber)
+  inc(gTokensLexed, lex.tokens)
   closeBaseLexer(lex)
 
 proc getColumn*(L: Lexer): int =
@@ -148,20 +168,53 @@ proc getColumn*(L: Lexer): int =
 proc getLineInfo*(L: Lexer): TLineInfo =
   result = newLineInfo(L.fileIdx, L.linenumber, getColNumber(L, L.bufpos))
 
+when compileOption("threads"):
+  import locks
+
+  var msgLock: Lock # messages can come from several parser threads
+  initLock(msgLock)
+
+  template serialized(body: untyped) =
+    withLock(msgLock): body
+else:
+  template serialized(body: untyped) = body
+
+proc quietMessage(L: Lexer; info: TLineInfo; msg: TMsgKind; arg: string) =
+  if msg >= errMin and msg <= errMax:
+    raise newException(EQuietError, arg)
+  L.quiet[].add((info, msg, arg))
+
 proc lexMessage*(L: Lexer, msg: TMsgKind, arg = "") =
   if L.debugMode: writeStackTrace()
-  when declared(NimCompilerApiVersion):
-    msgs.globalError(gConfig, getLineInfo(L), msg, arg)
+  if L.quiet != nil: quietMessage(L, getLineInfo(L), msg, arg)
   else:
-    msgs.globalError(getLineInfo(L), msg, arg)
+    serialized:
+      when declared(NimCompilerApiVersion):
+        msgs.globalError(gConfig, getLineInfo(L), msg, arg)
+      else:
+        msgs.globalError(getLineInfo(L), msg, arg)
 
 proc lexMessagePos(L: var Lexer, msg: TMsgKind, pos: int, arg = "") =
   var info = newLineInfo(L.fileIdx, L.linenumber, pos - L.lineStart)
   if L.debugMode: writeStackTrace()
-  when declared(NimCompilerApiVersion):
-    msgs.globalError(gConfig, info, msg, arg)
+  if L.quiet != nil: quietMessage(L, info, msg, arg)
   else:
-    msgs.globalError(info, msg, arg)
+    serialized:
+      when declared(NimCompilerApiVersion):
+        msgs.globalError(gConfig, info, msg, arg)
+      else:
+        msgs.globalError(info, msg, arg)
+
+proc replayMessages*(L: var Lexer) =
+  ## reports the warnings and hints that a quiet lexer kept.
+  if L.quiet == nil: return
+  for m in L.quiet[]:
+    serialized:
+      when declared(NimCompilerApiVersion):
+        msgs.globalError(gConfig, m.info, m.msg, m.arg)
+      else:
+        msgs.globalError(m.info, m.msg, m.arg)
+  L.quiet = nil
 
 proc tokKindToStr*(k: Tokkind): string =
   case k
@@ -704,6 +757,116 @@ proc scanVerbatim(L: var Lexer, tok: var Token; isCurlyDot: bool) =
       inc(pos)
   L.bufpos = pos
 
+proc skipVerbatim(L: var Lexer, pos: int, closing: string): int =
+  result = pos
+  while L.buf[result] != nimlexbase.EndOfFile:
+    if L.buf[result] in {CR, LF}:
+      result = handleCRLF(L, result)
+    elif L.buf[result] == closing[0] and L.buf[result+1] == closing[1]:
+      inc(result, 2)
+      break
+    else:
+      inc(result)
+
+proc skipCurlies*(L: var Lexer, nested: int): int =
+  ## Skips everything up to and including the '}' that closes `nested` open
+  ## curlies without producing any tokens. Strings, character literals and
+  ## comments are skipped as a whole. Stops in front of a directive, which
+  ## the parser has to see, and at the end of the file. Returns the number
+  ## of curlies that are still open.
+  var nested = nested
+  var pos = L.bufpos
+  var buf = L.buf
+  while true:
+    case buf[pos]
+    of '{':
+      if buf[pos+1] == '|':
+        pos = skipVerbatim(L, pos+2, "|}")
+        buf = L.buf
+      else:
+        inc(pos)
+        inc(nested)
+    of '}':
+      inc(pos)
+      dec(nested)
+      if nested == 0: break
+    of CR, LF:
+      pos = handleCRLF(L, pos)
+      buf = L.buf
+    of '\\':
+      inc(pos)
+      if buf[pos] in {CR, LF}:
+        pos = handleCRLF(L, pos)
+        buf = L.buf
+    of '/':
+      if buf[pos+1] == '/':
+        while buf[pos] notin {CR, LF, nimlexbase.EndOfFile}: inc(pos)
+      elif buf[pos+1] == '*':
+        inc(pos, 2)
+        while buf[pos] != nimlexbase.EndOfFile:
+          if buf[pos] in {CR, LF}:
+            pos = handleCRLF(L, pos)
+            buf = L.buf
+          elif buf[pos] == '*' and buf[pos+1] == '/':
+            inc(pos, 2)
+            break
+          else:
+            inc(pos)
+      else:
+        inc(pos)
+    of '"', '\'':
+      let quote = buf[pos]
+      if quote == '"' and pos > 0 and buf[pos-1] == 'R':
+        # C++ raw string literal: R"delim( ... )delim"
+        inc(pos)
+        var delim = ")"
+        while buf[pos] notin {'(', CR, LF, nimlexbase.EndOfFile}:
+          delim.add buf[pos]
+          inc(pos)
+        delim.add '"'
+        while buf[pos] != nimlexbase.EndOfFile:
+          if buf[pos] in {CR, LF}:
+            pos = handleCRLF(L, pos)
+            buf = L.buf
+          elif endsWith(buf, pos, delim):
+            inc(pos, delim.len)
+            break
+          else:
+            inc(pos)
+      else:
+        inc(pos)
+        while buf[pos] notin {quote, CR, LF, nimlexbase.EndOfFile}:
+          if buf[pos] == '\\':
+            inc(pos)
+            if buf[pos] in {CR, LF}:
+              pos = handleCRLF(L, pos)
+              buf = L.buf
+              continue
+          inc(pos)
+        if buf[pos] == quote: inc(pos)
+    of '0'..'9':
+      if pos == 0 or buf[pos-1] notin SymChars:
+        # a number; like in 'matchUnderscoreChars' a quote after a digit
+        # is a digit separator:
+        inc(pos)
+        while buf[pos] in SymChars + {'.'} or
+            (buf[pos] == '\'' and buf[pos-1] in SymChars):
+          inc(pos)
+      else:
+        inc(pos)
+    of '#':
+      if buf[pos+1] == '@':
+        pos = skipVerbatim(L, pos+2, "@#")
+        buf = L.buf
+      else:
+        break
+    of nimlexbase.EndOfFile:
+      break
+    else:
+      inc(pos)
+  L.bufpos = pos
+  result = nested
+
 proc skip(L: var Lexer, tok: var Token) =
   var pos = L.bufpos
   var buf = L.buf
@@ -750,6 +913,7 @@ proc getDirective(L: var Lexer, tok: var Token) =
   L.inDirective = true
 
 proc getTok*(L: var Lexer, tok: var Token) =
+  inc(L.tokens)
   tok.xkind = pxInvalid
   fillToken(tok)
   skip(L, tok)
@@ -14,6 +14,9 @@
 import
   hashes, strutils, wordrecg
 
+when compileOption("threads"):
+  import locks
+
 type
   TIdObj* = object of RootObj
     id*: int # unique id; use this for comparisons and not the pointers
@@ -22,11 +25,18 @@ type
   PIdent* = ref TIdent
   TIdent*{.acyclic.} = object of TIdObj
     s*: string
-    next*: PIdent             # for hash-table chaining
     h*: Hash                 # hash value of s
 
+  IdentShard = object
+    data: seq[PIdent]        # open addressing; the length is a power of 2
+    counter: int             # number of used slots
+    when compileOption("threads"):
+      lock: Lock
+
   IdentCache* = ref object
-    buckets: array[0..4096 * 2 - 1, PIdent]
+    # c2nim interns identifiers from several threads. Every spelling of an
+    # identifier has the same hash and thus ends up in the same shard:
+    shards: array[16, IdentShard]
     wordCounter: int
     idAnon*, idDelegator*, emptyIdent*: PIdent
 
@@ -66,35 +76,71 @@ proc cmpExact(a, b: cstring, blen: int): int =
   if result == 0:
     if a[i] != '\0': result = 1
 
-proc getIdent*(ic: IdentCache; identifier: cstring, length: int, h: Hash): PIdent =
-  var idx = h and high(ic.buckets)
-  result = ic.buckets[idx]
-  var last: PIdent = nil
+const
+  ShardBits = 4 # the low bits of the hash select the shard
+  StartSize = 4096 * 2 shr ShardBits
+
+proc nextTry(h, maxHash: Hash): Hash {.inline.} =
+  result = (h + 1) and maxHash
+
+proc mustRehash(length, counter: int): bool {.inline.} =
+  result = length * 2 < counter * 3 or length - counter < 4
+
+proc slot(h: Hash; data: seq[PIdent]): Hash {.inline.} =
+  result = (h shr ShardBits) and high(data)
+
+proc rawInsert(data: var seq[PIdent]; x: PIdent) =
+  var h = slot(x.h, data)
+  while data[h] != nil: h = nextTry(h, high(data))
+  data[h] = x
+
+proc enlarge(s: var IdentShard) =
+  var n = newSeq[PIdent](s.data.len * 2)
+  for x in s.data:
+    if x != nil: rawInsert(n, x)
+  swap(s.data, n)
+
+proc nextId(ic: IdentCache): int {.inline.} =
+  when compileOption("threads"):
+    result = atomicInc(ic.wordCounter)
+  else:
+    inc(ic.wordCounter)
+    result = ic.wordCounter
+
+proc getIdentImpl(ic: IdentCache; s: var IdentShard;
+                  identifier: cstring, length: int, h: Hash): PIdent =
+  # 'h' ignores the style, so all spellings of an identifier are in the
+  # same cluster and the probing sees them before it reaches a free slot:
+  var idx = slot(h, s.data)
   var id = 0
-  while result != nil:
-    if cmpExact(cstring(result.s), identifier, length) == 0:
-      if last != nil:
-        # make access to last looked up identifier faster:
-        last.next = result.next
-        result.next = ic.buckets[idx]
-        ic.buckets[idx] = result
-      return
-    elif cmpIgnoreStyle(cstring(result.s), identifier, length) == 0:
-      assert((id == 0) or (id == result.id))
-      id = result.id
-    last = result
-    result = result.next
+  while s.data[idx] != nil:
+    result = s.data[idx]
+    if result.h == h:
+      if cmpExact(cstring(result.s), identifier, length) == 0:
+        return
+      elif cmpIgnoreStyle(cstring(result.s), identifier, length) == 0:
+        assert((id == 0) or (id == result.id))
+        id = result.id
+    idx = nextTry(idx, high(s.data))
   new(result)
   result.h = h
   result.s = newString(length)
   for i in 0 ..< length: result.s[i] = identifier[i]
-  result.next = ic.buckets[idx]
-  ic.buckets[idx] = result
-  if id == 0:
-    inc(ic.wordCounter)
-    result.id = -ic.wordCounter
+  if mustRehash(s.data.len, s.counter + 1):
+    enlarge(s)
+    rawInsert(s.data, result)
   else:
-    result.id = id
+    s.data[idx] = result
+  inc(s.counter)
+  result.id = if id == 0: -nextId(ic) else: id
+
+proc getIdent*(ic: IdentCache; identifier: cstring, length: int, h: Hash): PIdent =
+  template s: untyped = ic.shards[h and high(ic.shards)]
+  when compileOption("threads"):
+    withLock(s.lock):
+      result = getIdentImpl(ic, s, identifier, length, h)
+  else:
+    result = getIdentImpl(ic, s, identifier, length, h)
 
 proc getIdent*(ic: IdentCache; identifier: string): PIdent =
   result = getIdent(ic, cstring(identifier), len(identifier),
@@ -105,6 +151,10 @@ proc getIdent*(ic: IdentCache; identifier: string, h: Hash): PIdent =
 
 proc newIdentCache*(): IdentCache =
   result = IdentCache()
+  for s in mitems(result.shards):
+    s.data = newSeq[PIdent](StartSize)
+    when compileOption("threads"):
+      initLock(s.lock)
   result.idAnon = result.getIdent":anonymous"
   result.wordCounter = 1
   result.idDelegator = result.getIdent":delegator"
@@ -116,3 +166,23 @@ proc newIdentCache*(): IdentCache =
 proc whichKeyword*(id: PIdent): TSpecialWord =
   if id.id < 0: result = wInvalid
   else: result = TSpecialWord(id.id)
+
+when isMainModule:
+  import times
+
+  proc bench(words: int) =
+    # interns `words` distinct identifiers in two spellings each and then
+    # looks all of them up again:
+    let ic = newIdentCache()
+    var names = newSeq[string](words)
+    for i in 0 ..< words: names[i] = "c2nimIdent" & $i
+    let t0 = cpuTime()
+    for x in names: discard ic.getIdent(x)
+    for x in names: discard ic.getIdent("c2nim_ident" & x.substr(10))
+    let t1 = cpuTime()
+    for x in names:
+      doAssert ic.getIdent(x).id == ic.getIdent("c2nim_ident" & x.substr(10)).id
+    let t2 = cpuTime()
+    echo words, " identifiers: intern ", t1 - t0, "s, lookup ", t2 - t1, "s"
+
+  bench(1_000_000)
@@ -11,6 +11,19 @@ import
   options, strutils, os, tables, ropes, terminal, macros,
   lineinfos, pathutils
 
+when compileOption("threads"):
+  import locks
+
+  # c2nim registers and looks up files from several threads:
+  var fileInfosLock: Lock
+  initLock(fileInfosLock)
+
+template withFileInfos(body: untyped) =
+  when compileOption("threads"):
+    withLock(fileInfosLock): body
+  else:
+    body
+
 proc toCChar*(c: char; result: var string) =
   case c
   of '\0'..'\x1F', '\x7F'..'\xFF':
@@ -64,7 +77,8 @@ proc fileInfoKnown*(conf: ConfigRef; filename: AbsoluteFile): bool =
     canon = canonicalizePath(conf, filename)
   except OSError:
     canon = filename
-  result = conf.m.filenameToIndexTbl.hasKey(canon.string)
+  withFileInfos:
+    result = conf.m.filenameToIndexTbl.hasKey(canon.string)
 
 proc fileInfoIdx*(conf: ConfigRef; filename: AbsoluteFile; isKnownFile: var bool): FileIndex =
   var
@@ -81,14 +95,15 @@ proc fileInfoIdx*(conf: ConfigRef; filename: AbsoluteFile; isKnownFile: var bool
     # This flag indicates that we are working with such a path here
     pseudoPath = true
 
-  if conf.m.filenameToIndexTbl.hasKey(canon.string):
-    result = conf.m.filenameToIndexTbl[canon.string]
-  else:
-    isKnownFile = false
-    result = conf.m.fileInfos.len.FileIndex
-    conf.m.fileInfos.add(newFileInfo(canon, if pseudoPath: RelativeFile filename
-                                            else: relativeTo(canon, conf.projectPath)))
-    conf.m.filenameToIndexTbl[canon.string] = result
+  withFileInfos:
+    if conf.m.filenameToIndexTbl.hasKey(canon.string):
+      result = conf.m.filenameToIndexTbl[canon.string]
+    else:
+      isKnownFile = false
+      result = conf.m.fileInfos.len.FileIndex
+      conf.m.fileInfos.add(newFileInfo(canon, if pseudoPath: RelativeFile filename
+                                              else: relativeTo(canon, conf.projectPath)))
+      conf.m.filenameToIndexTbl[canon.string] = result
 
 proc fileInfoIdx*(conf: ConfigRef; filename: AbsoluteFile): FileIndex =
   var dummy: bool
@@ -164,22 +179,29 @@ proc getInfoContext*(conf: ConfigRef; index: int): TLineInfo =
 const
   commandLineDesc = "command line"
 
+proc shortName(conf: ConfigRef; fileIdx: FileIndex): string =
+  withFileInfos:
+    result = conf.m.fileInfos[fileIdx.int32].shortName
+
 template toFilename*(conf: ConfigRef; fileIdx: FileIndex): string =
   if fileIdx.int32 < 0 or conf == nil:
     (if fileIdx == commandLineIdx: commandLineDesc else: "???")
   else:
-    conf.m.fileInfos[fileIdx.int32].shortName
+    shortName(conf, fileIdx)
 
 proc toProjPath*(conf: ConfigRef; fileIdx: FileIndex): string =
   if fileIdx.int32 < 0 or conf == nil:
-    (if fileIdx == commandLineIdx: commandLineDesc else: "???")
-  else: conf.m.fileInfos[fileIdx.int32].projPath.string
+    result = (if fileIdx == commandLineIdx: commandLineDesc else: "???")
+  else:
+    withFileInfos:
+      result = conf.m.fileInfos[fileIdx.int32].projPath.string
 
 proc toFullPath*(conf: ConfigRef; fileIdx: FileIndex): string =
   if fileIdx.int32 < 0 or conf == nil:
     result = (if fileIdx == commandLineIdx: commandLineDesc else: "???")
   else:
-    result = conf.m.fileInfos[fileIdx.int32].fullPath.string
+    withFileInfos:
+      result = conf.m.fileInfos[fileIdx.int32].fullPath.string
 
 proc setDirtyFile*(conf: ConfigRef; fileIdx: FileIndex; filename: AbsoluteFile) =
   assert fileIdx.int32 >= 0
@@ -203,10 +225,12 @@ proc getHash*(conf: ConfigRef; fileIdx: FileIndex): string =
 proc toFullPathConsiderDirty*(conf: ConfigRef; fileIdx: FileIndex): AbsoluteFile =
   if fileIdx.int32 < 0:
     result = AbsoluteFile(if fileIdx == commandLineIdx: commandLineDesc else: "???")
-  elif not conf.m.fileInfos[fileIdx.int32].dirtyFile.isEmpty:
-    result = conf.m.fileInfos[fileIdx.int32].dirtyFile
   else:
-    result = conf.m.fileInfos[fileIdx.int32].fullPath
+    withFileInfos:
+      if not conf.m.fileInfos[fileIdx.int32].dirtyFile.isEmpty:
+        result = conf.m.fileInfos[fileIdx.int32].dirtyFile
+      else:
+        result = conf.m.fileInfos[fileIdx.int32].fullPath
 
 template toFilename*(conf: ConfigRef; info: TLineInfo): string =
   toFilename(conf, info.fileIndex)
@@ -581,10 +605,12 @@ template internalAssert*(conf: ConfigRef, e: bool) =
 proc quotedFilename*(conf: ConfigRef; i: TLineInfo): Rope =
   if i.fileIndex.int32 < 0:
     result = makeCString "???"
-  elif optExcessiveStackTrace in conf.globalOptions:
-    result = conf.m.fileInfos[i.fileIndex.int32].quotedFullName
   else:
-    result = conf.m.fileInfos[i.fileIndex.int32].quotedName
+    withFileInfos:
+      if optExcessiveStackTrace in conf.globalOptions:
+        result = conf.m.fileInfos[i.fileIndex.int32].quotedFullName
+      else:
+        result = conf.m.fileInfos[i.fileIndex.int32].quotedName
 
 proc listWarnings*(conf: ConfigRef) =
   msgWriteln(conf, "Warnings:")
@@ -10,11 +10,19 @@
 # This module implements the renderer of the standard Nim representation.
 
 import
-  lexer, options, idents, strutils, ast, msgs, lineinfos
+  lexer, options, idents, strutils, ast, msgs, lineinfos, tables
 
 when defined(nimPreviewSlimSystem):
   import std/[syncio, assertions, formatfloat]
 
+const
+  ParallelRendering = compileOption("threads") and defined(gcAtomicArc)
+    ## the threads share the nodes and the identifiers; only atomic
+    ## reference counting makes that safe
+
+when ParallelRendering and (NimMajor, NimMinor) >= (2, 0):
+  import std/typedthreads
+
 type
   TRenderFlag* = enum
     renderNone, renderNoBody, renderNoComments, renderDocComments,
@@ -29,6 +37,7 @@ type
     sym*: PSym
 
   TRenderTokSeq* = seq[TRenderTok]
+  RenderSink* = proc (s: string) {.closure.} ## receives the rendered text
   TSrcGen* = object
     indent*: int
     lineLen*: int
@@ -49,6 +58,12 @@ type
       pendingNewlineCount: int
     fid*: FileIndex
     config*: ConfigRef
+    lsubCache: ref Table[pointer, int] # the lengths of the inner nodes;
+                                       # nil: not remembered
+    sink: RenderSink       # nil: everything stays in 'buf'
+    sinkThreshold: int     # flush the completed lines beyond this size
+    flushAt: int           # buffer size for the next attempt to flush
+    flushedToks: int       # number of tokens already passed to the sink
 
 proc setOption*(renderOptions: var TRenderFlags, val: string): bool =
   result = true
@@ -126,11 +141,27 @@ proc initSrcGen(g: var TSrcGen, renderFlags: TRenderFlags; config: ConfigRef) =
   g.inGenericParams = false
   g.config = config
 
+proc flushLines(g: var TSrcGen) =
+  # passes the completed lines to the sink. The rest stays, as the
+  # renderer still looks at the last character and token:
+  var last = g.buf.len - 2
+  while last >= 0 and g.buf[last] != '\L': dec last
+  if last >= 0:
+    g.sink(substr(g.buf, 0, last))
+    g.buf = substr(g.buf, last+1)
+    inc g.flushedToks, g.tokens.len - 1
+    g.tokens[0] = g.tokens[^1]
+    setLen(g.tokens, 1)
+  g.flushAt = g.buf.len + g.sinkThreshold
+
 proc addTok(g: var TSrcGen, kind: TTokType, s: string; sym: PSym = nil) =
   g.tokens.add TRenderTok(kind: kind, length: int16(s.len), sym: sym)
   g.buf.add(s)
   if kind != tkSpaces:
     inc g.col, s.len
+  if g.sink != nil and g.buf.len >= g.flushAt: flushLines(g)
+
+proc tokCount(g: TSrcGen): int {.inline.} = g.flushedToks + g.tokens.len
 
 proc addPendingNL(g: var TSrcGen) =
   if g.pendingNL >= 0:
@@ -413,7 +444,7 @@ proc lsons(g: TSrcGen; n: PNode, start: int = 0, theEnd: int = - 1): int =
   result = 0
   for i in start .. sonsLen(n) + theEnd: inc(result, lsub(g, n.sons[i]))
 
-proc lsub(g: TSrcGen; n: PNode): int =
+proc lsubAux(g: TSrcGen; n: PNode): int =
   # computes the length of a tree
   if isNil(n): return 0
   if shouldRenderComment(g, n): return MaxLineLen + 1
@@ -539,6 +570,16 @@ proc lsub(g: TSrcGen; n: PNode): int =
     result = len("object_")
   else: result = MaxLineLen + 1
 
+proc lsub(g: TSrcGen; n: PNode): int =
+  # 'gsub' asks for the length of the same subtrees at every level, so the
+  # lengths of the inner nodes are remembered for the current statement:
+  if isNil(n) or safeLen(n) == 0 or g.lsubCache == nil: return lsubAux(g, n)
+  let key = cast[pointer](n)
+  result = g.lsubCache[].getOrDefault(key, -1)
+  if result < 0:
+    result = lsubAux(g, n)
+    g.lsubCache[][key] = result
+
 proc fits(g: TSrcGen, x: int): bool =
   result = x <= MaxLineLen
 
@@ -581,10 +622,10 @@ proc gcommaAux(g: var TSrcGen, n: PNode, ind: int, start: int = 0,
     var c = i < sonsLen(n) + theEnd
     var sublen = lsub(g, n.sons[i]) + ord(c)
     if not fits(g, g.lineLen + sublen) and (ind + sublen < MaxLineLen): optNL(g, ind)
-    let oldLen = g.tokens.len
+    let oldLen = tokCount(g)
     gsub(g, n.sons[i])
     if c:
-      if g.tokens.len > oldLen:
+      if tokCount(g) > oldLen:
         putWithSpace(g, separator, TokTypeToStr[separator])
       if shouldRenderComment(g) and hasCom(n.sons[i]):
         gcoms(g)
@@ -1671,25 +1712,124 @@ proc renderTree*(n: PNode, renderFlags: TRenderFlags = {}): string =
 
 proc `$`*(n: PNode): string = n.renderTree
 
+proc initModuleRender*(g: var TSrcGen; renderFlags: TRenderFlags = {};
+                       conf: ConfigRef = nil) =
+  ## prepares `g` to render a module one top level statement at a time.
+  initSrcGen(g, renderFlags, conf)
+
+const
+  MaxLsubCache = 4096 # a larger cache is dropped instead of cleared
+
+proc renderTopLevel*(g: var TSrcGen; n: PNode) =
+  ## renders the next top level statement of a module.
+  if g.lsubCache == nil: new(g.lsubCache)
+  gsub(g, n)
+  if g.lsubCache[].len > MaxLsubCache: g.lsubCache = nil
+  else: clear(g.lsubCache[])
+  optNL(g)
+  case n.kind
+  of nkTypeSection, nkConstSection, nkVarSection, nkLetSection,
+     nkCommentStmt: putNL(g)
+  else: discard
+
+proc setSink*(g: var TSrcGen; sink: RenderSink; threshold = 64 * 1024) =
+  ## lets `g` pass its output to `sink` in chunks of complete lines as
+  ## soon as more than `threshold` bytes are buffered.
+  g.sink = sink
+  g.sinkThreshold = threshold
+  g.flushAt = g.buf.len + threshold
+
+proc finishModule*(g: var TSrcGen) =
+  ## renders the pending comments and passes the rest of the output to
+  ## the sink, if there is one.
+  gcoms(g)
+  if g.sink != nil and g.buf.len > 0:
+    g.sink(g.buf)
+    g.buf = ""
+    inc g.flushedToks, g.tokens.len
+    setLen(g.tokens, 0)
+
+type
+  RenderJob = object # a range of top level statements for one thread
+    g: TSrcGen
+    n: PNode
+    first, last: int
+
+const
+  MinStmtsPerThread {.intdefine.} = 64 # fewer statements are not worth a thread
+
+when ParallelRendering:
+  proc renderRange(job: ptr RenderJob) {.thread.} =
+    {.cast(gcsafe).}:
+      for i in job.first ..< job.last:
+        renderTopLevel(job.g, job.n.sons[i])
+
+proc adoptRange(g: var TSrcGen; w: var TSrcGen) =
+  # appends the output of `w` to `g` and continues with the state of `w`:
+  g.buf.add(w.buf)
+  if w.tokens.len > 0:
+    if g.sink == nil:
+      g.tokens.add(w.tokens)
+    else:
+      inc g.flushedToks, g.tokens.len + w.tokens.len - 1
+      g.tokens = @[w.tokens[^1]]
+  g.indent = w.indent
+  g.lineLen = w.lineLen
+  g.col = w.col
+  g.pendingNL = w.pendingNL
+  g.pendingWhitespace = w.pendingWhitespace
+  g.comStack = move(w.comStack)
+  g.inGenericParams = w.inGenericParams
+  g.checkAnon = w.checkAnon
+  g.inPragma = w.inPragma
+  if g.sink != nil and g.buf.len >= g.flushAt: flushLines(g)
+
+proc renderStatements*(g: var TSrcGen; n: PNode; threads = 1) =
+  ## renders the statements of the module `n` like `renderTopLevel`, with
+  ## `threads` > 1 on threads: Between two top level statements the state
+  ## of the renderer is always the same, unless comments are pending, so
+  ## ranges of statements can be rendered independently. A range that
+  ## follows pending comments is rendered again in order.
+  let chunks = min(threads, sonsLen(n) div MinStmtsPerThread)
+  when ParallelRendering:
+    if chunks > 1:
+      var jobs = newSeq[RenderJob](chunks)
+      for t in 1 ..< chunks:
+        initModuleRender(jobs[t].g, g.flags, g.config)
+        jobs[t].g.fid = g.fid
+        optNL(jobs[t].g, 0) # as after the previous statement
+        jobs[t].n = n
+        jobs[t].first = sonsLen(n) * t div chunks
+        jobs[t].last = sonsLen(n) * (t+1) div chunks
+      var workers = newSeq[Thread[ptr RenderJob]](chunks-1)
+      for t in 1 ..< chunks:
+        createThread(workers[t-1], renderRange, addr(jobs[t]))
+      for i in 0 ..< jobs[1].first:
+        renderTopLevel(g, n.sons[i])
+      joinThreads(workers)
+      for t in 1 ..< chunks:
+        if g.comStack.len == 0:
+          adoptRange(g, jobs[t].g)
+        else:
+          for i in jobs[t].first ..< jobs[t].last:
+            renderTopLevel(g, n.sons[i])
+      return
+  for i in 0 ..< sonsLen(n):
+    renderTopLevel(g, n.sons[i])
+
 proc renderModule*(n: PNode, infile, outfile: string,
                    renderFlags: TRenderFlags = {};
                    fid = FileIndex(-1);
-                   conf: ConfigRef = nil) =
+                   conf: ConfigRef = nil; threads = 1) =
   var
     f: File
     g: TSrcGen
-  initSrcGen(g, renderFlags, conf)
+  initModuleRender(g, renderFlags, conf)
   g.fid = fid
-  for i in 0 ..< sonsLen(n):
-    gsub(g, n.sons[i])
-    optNL(g)
-    case n.sons[i].kind
-    of nkTypeSection, nkConstSection, nkVarSection, nkLetSection,
-       nkCommentStmt: putNL(g)
-    else: discard
-  gcoms(g)
   if open(f, outfile, fmWrite):
-    write(f, g.buf)
+    setSink(g, proc (s: string) = write(f, s))
+    renderStatements(g, n, threads)
+    finishModule(g)
     close(f)
   else:
     rawMessage(g.config, errGenerated, "cannot open file: " & outfile)
@@ -20,7 +20,7 @@
 import
   os, compiler/llstream, compiler/renderer, clexer, compiler/idents, strutils,
   pegs, tables, compiler/ast, compiler/msgs,
-  strtabs, hashes, algorithm, compiler/nversion
+  strtabs, hashes, algorithm, sets, compiler/nversion, tracing
 from sequtils import mapIt
 
 when declared(NimCompilerApiVersion):
@@ -31,6 +31,8 @@ when declared(NimCompilerApiVersion):
 
 import pegs except Token, Tokkind
 
+include profiler
+
 type
   ParserFlag* = enum
     pfStrict,         ## do not use the "best effort" parsing approach
@@ -61,13 +63,21 @@ type
     pfNoMultiMangle,     ## allow multiple mangles
     pfCppBindStatic,     ## bind cpp static methods to types
     pfAnonymousAsFields, ## treat anonymous union/struct as fields
-    pfClibUserPragma     ## user `clib` pragma instead of dynlib or header
+    pfClibUserPragma,    ## user `clib` pragma instead of dynlib or header
+    pfTypeTable          ## classify statements via the table of known types
 
   Macro* = object
     name*: string
     params*: int # number of parameters; 0 for empty (); -1 for no () at all
     body*: seq[ref Token] # can contain pxMacroParam tokens
 
+  MangleIndex = object # the mangling rules by the characters they can match
+    valid: bool
+    rules: array[char, seq[int]] # indexes into mangleRules, in order
+    emptyRules: seq[int] # the rules that can match the empty name
+    prefixes: array[char, seq[int]] # indexes into prefixes by first char
+    suffixes: array[char, seq[int]] # indexes into suffixes by last char
+
   ParserOptions = object ## shared parser state!
     flags*: set[ParserFlag]
     renderFlags*: TRenderFlags
@@ -80,6 +90,7 @@ type
     deletes*: Table[string, string]
     toMangle: StringTableRef
     classes: StringTableRef
+    knownTypes: StringTableRef # type names seen so far; used by pfTypeTable
     toPreprocess: StringTableRef
     inheritable: StringTableRef
     debugMode, followNep1: bool
@@ -89,6 +100,12 @@ type
     exportPrefix*: string
     paramPrefix*: string
     isArray: StringTableRef
+    anonUnions: int # number of anonymous unions seen so far
+    mangled: array[TSymKind, Table[string, PIdent]] # memo for mangledIdent
+    privates: Table[string, bool] # memo for isPrivate
+    mangleIndex: MangleIndex
+    workers*: int # > 1: parse the regions of a file in parallel
+    profileBacktracks*: bool # count the backtracking; see profiler.nim
 
   PParserOptions* = ref ParserOptions
 
@@ -117,6 +134,10 @@ type
     continueActions: seq[PNode]
     currentSection: Section # can be nil
     anoTypeCount: int
+    macrosChecked: int # macros checked by hasCurlyMacros so far
+    curlyMacros: bool
+    backtracks: int    # number of times the parser went back
+    profile: BacktrackProfile # nil unless options.profileBacktracks
 
   ReplaceTuple* = array[0..1, string]
 
@@ -125,6 +146,7 @@ type
   SectionParser = proc(p: var Parser): PNode {.nimcall.}
 
 proc parseDir(p: var Parser; sectionParser: SectionParser, recur = false): PNode
+proc statement(p: var Parser): PNode
 proc addTypeDef(section, name, t, genericParams: PNode)
 proc parseStruct(p: var Parser, stmtList: PNode): PNode
 proc parseStructBody(p: var Parser, stmtList: PNode,
@@ -150,6 +172,7 @@ proc newParserOptions*(): PParserOptions =
     headerPrefix: "",
     toMangle: newStringTable(modeCaseSensitive),
     classes: newStringTable(modeCaseSensitive),
+    knownTypes: newStringTable(modeCaseSensitive),
     toPreprocess: newStringTable(modeCaseSensitive),
     inheritable: newStringTable(modeCaseSensitive),
     constructor: "construct",
@@ -159,9 +182,19 @@ proc newParserOptions*(): PParserOptions =
     paramPrefix: "a",
     isArray: newStringTable(modeCaseSensitive))
 
+proc invalidateMangling(o: PParserOptions) =
+  # the mangling rules changed, so the memoized names are stale:
+  for k in TSymKind: clear(o.mangled[k])
+  clear(o.privates)
+  o.mangleIndex.valid = false
+
 proc setOption*(parserOptions: PParserOptions, key: string, val=""): bool =
   result = true
   case key.normalize
+  of "prefix", "suffix", "mangle", "stdints", "nep1", "nomultimangle":
+    invalidateMangling(parserOptions)
+  else: discard
+  case key.normalize
   of "strict": incl(parserOptions.flags, pfStrict)
   of "ref": incl(parserOptions.flags, pfRefs)
   of "dynlib": parserOptions.dynlibSym = val
@@ -220,6 +253,8 @@ proc setOption*(parserOptions: PParserOptions, key: string, val=""): bool =
   of "cppspecialization":incl(parserOptions.flags, pfCppSpecialization)
   of "cppskipcallop":incl(parserOptions.flags, pfCppSkipCallOp)
   of "nomultimangle":incl(parserOptions.flags, pfNoMultiMangle)
+  of "typetable": incl(parserOptions.flags, pfTypeTable)
+  of "knowntype": parserOptions.knownTypes[val] = "true"
   of "isarray": parserOptions.isArray[val] = "true"
   of "delete": parserOptions.deletes[val] = ""
   else: result = false
@@ -237,6 +272,7 @@ proc openParser*(p: var Parser, filename: string,
   p.currentClassOrig = ""
   p.classHierarchy = @[]
   p.classHierarchyGP = @[]
+  if options.profileBacktracks: p.profile = BacktrackProfile()
   new(p.tok)
 
 proc debugTok*(p: Parser): string =
@@ -259,16 +295,46 @@ proc parError(p: Parser, arg = "") =
       lexMessage(p.lex, warnSyntaxError, arg)
     raise newException(ERetryParsing, arg)
 
-proc closeParser*(p: var Parser) = closeLexer(p.lex)
+var
+  gBacktracks*: int ## backtracking of all closed parsers
 
-proc saveContext(p: var Parser) = p.backtrack.add(p.tok)
-# EITHER call 'closeContext' or 'backtrackContext':
-proc closeContext(p: var Parser) = discard p.backtrack.pop()
-proc backtrackContext(p: var Parser) = p.tok = p.backtrack.pop()
+proc closeParser*(p: var Parser) =
+  inc(gBacktracks, p.backtracks)
+  if p.profile != nil: mergeProfile(p.profile)
+  closeLexer(p.lex)
+
+proc inputLine(p: Parser): string = p.header & "(" & $p.tok.lineNumber & ")"
 
-proc saveContextB(p: var Parser; produceWarnings=false) = p.backtrackB.add((p.tok, produceWarnings))
-proc closeContextB(p: var Parser) = discard p.backtrackB.pop()
-proc backtrackContextB(p: var Parser) = p.tok = p.backtrackB.pop()[0]
+proc saveContextImpl(p: var Parser; site: BacktrackSite) =
+  if p.profile != nil: attempt(p.profile, p.profile.sites, site, inputLine(p))
+  p.backtrack.add(p.tok)
+template saveContext(p: var Parser) =
+  let info = instantiationInfo()
+  saveContextImpl(p, (info.filename, info.line))
+# EITHER call 'closeContext' or 'backtrackContext':
+proc closeContext(p: var Parser) =
+  if p.profile != nil: discard p.profile.sites.pop()
+  discard p.backtrack.pop()
+proc backtrackContext(p: var Parser) =
+  inc(p.backtracks)
+  if p.profile != nil:
+    backtracked(p.profile, p.profile.sites, distance(p.backtrack[^1], p.tok))
+  p.tok = p.backtrack.pop()
+
+proc saveContextBImpl(p: var Parser; site: BacktrackSite; produceWarnings: bool) =
+  if p.profile != nil: attempt(p.profile, p.profile.sitesB, site, inputLine(p))
+  p.backtrackB.add((p.tok, produceWarnings))
+template saveContextB(p: var Parser; produceWarnings=false) =
+  let info = instantiationInfo()
+  saveContextBImpl(p, (info.filename, info.line), produceWarnings)
+proc closeContextB(p: var Parser) =
+  if p.profile != nil: discard p.profile.sitesB.pop()
+  discard p.backtrackB.pop()
+proc backtrackContextB(p: var Parser) =
+  inc(p.backtracks)
+  if p.profile != nil:
+    backtracked(p.profile, p.profile.sitesB, distance(p.backtrackB[^1][0], p.tok))
+  p.tok = p.backtrackB.pop()[0]
 
 proc rawGetTok(p: var Parser) =
   if p.tok.next != nil:
@@ -356,6 +422,7 @@ proc expandMacro(p: var Parser, m: Macro) =
     var lastTok = newList
     var mergeToken = false
     template appendTok(t) {.dirty.} =
+      t.fromMacro = true
       if mergeToken:
         mergeToken = false
         lastTok.s &= t.s
@@ -372,6 +439,8 @@ proc expandMacro(p: var Parser, m: Macro) =
         for t in items(arguments[tok.position]):
           var newToken: ref Token
           new(newToken); newToken[] = t[]
+          newToken.angle = amUnknown
+          newToken.closer = nil
           appendTok(newToken)
       elif tok.xkind == pxDirConc:
         # implement token merging:
@@ -437,15 +506,72 @@ proc eat(p: var Parser, tok: string, n: PNode) =
   if p.tok.s == tok: getTok(p, n)
   else: parError(p, "token expected: " & tok & " but got: " & tokKindToStr(p.tok.xkind))
 
+proc hasCurlyMacros(p: var Parser): bool =
+  # macros that expand to curlies require token based skipping:
+  while p.macrosChecked < p.options.macros.len:
+    for t in p.options.macros[p.macrosChecked].body:
+      if t.xkind in {pxCurlyLe, pxCurlyRi}: p.curlyMacros = true
+    inc(p.macrosChecked)
+  result = p.curlyMacros
+
+proc skipBodyTokens(p: var Parser; nested: int) =
+  # skips the rest of a body with `nested` open curlies token by token. Its
+  # directives are processed as if the body was parsed:
+  var nested = nested
+  while true:
+    case p.tok.xkind
+    of pxCurlyLe: inc(nested)
+    of pxCurlyRi:
+      dec(nested)
+      if nested == 0: break
+    of pxDirective, pxDirectiveParLe:
+      discard parseDir(p, statement)
+      continue
+    of pxEof:
+      parError(p, "token expected: " & tokKindToStr(pxCurlyRi))
+      break
+    else: discard
+    getTok(p)
+  getTok(p)
+
 proc skipBody*(p: var Parser): bool =
   ## skip bodies
   if p.tok.xkind == pxCurlyLe:
-    eat(p, pxCurlyLe)
-    while p.tok.xkind != pxCurlyRi:
-      getTok(p)
-      if p.tok.xkind == pxCurlyLe:
-        discard skipBody(p)
-    eat(p, pxCurlyRi)
+    if p.lex.inDirective or p.inPreprocessorExpr > 0 or hasCurlyMacros(p):
+      eat(p, pxCurlyLe)
+      while p.tok.xkind != pxCurlyRi:
+        getTok(p)
+        if p.tok.xkind == pxCurlyLe:
+          discard skipBody(p)
+      eat(p, pxCurlyRi)
+      return true
+    # the tokens that have been read ahead already are walked, the lexer
+    # skips the rest without producing tokens up to the next directive:
+    var nested = 0
+    while true:
+      case p.tok.xkind
+      of pxCurlyLe: inc(nested)
+      of pxCurlyRi: dec(nested)
+      of pxDirective, pxDirectiveParLe:
+        skipBodyTokens(p, nested)
+        return true
+      else: discard
+      if nested == 0 or p.tok.next == nil: break
+      p.tok = p.tok.next
+    if nested > 0:
+      nested = skipCurlies(p.lex, nested)
+      if nested > 0:
+        # a directive or the end of the file:
+        getTok(p)
+        skipBodyTokens(p, nested)
+        return true
+      var t: ref Token
+      new(t)
+      t.xkind = pxCurlyRi
+      t.lineNumber = p.lex.lineNumber
+      p.tok.next = t
+      p.tok = t
+    getTok(p)
     return true
 
 proc opt(p: var Parser, xkind: Tokkind, n: PNode) =
@@ -520,7 +646,16 @@ proc skipIdentExport(p: var Parser; kind: TSymKind, nest: bool = false): PNode =
     result = exportSym(p, mangledIdent(p.tok.s, p, kind), p.tok.s)
   getTok(p, result)
 
+proc rememberTypeName(p: var Parser) =
+  # records the type name that is about to be defined:
+  if pfTypeTable in p.options.flags and p.tok.xkind == pxSymbol:
+    p.options.knownTypes[p.tok.s] = "true"
+
+proc isKnownType(p: Parser, s: string): bool =
+  p.options.knownTypes.hasKey(s) or p.options.classes.hasKey(s)
+
 proc markTypeIdent(p: var Parser, typ: PNode) =
+  rememberTypeName(p)
   if pfTypePrefixes in p.options.flags:
     var prefix = ""
     if typ == nil or typ.kind == nkEmpty:
@@ -537,13 +672,13 @@ proc markTypeIdent(p: var Parser, typ: PNode) =
 # --------------- parser -----------------------------------------------------
 # We use this parsing rule: If it looks like a declaration, it is one. This
 # avoids to build a symbol table, which can't be done reliably anyway for our
-# purposes.
+# purposes. With ``--typeTable`` the type names defined so far are recorded
+# and used to resolve the ambiguous cases inside of function bodies.
 
 proc expression(p: var Parser, rbp: int = 0; parent: PNode = nil): PNode
 proc constantExpression(p: var Parser; parent: PNode = nil): PNode = expression(p, 40, parent)
 proc assignmentExpression(p: var Parser): PNode = expression(p, 30)
 proc compoundStatement(p: var Parser; newScope=true): PNode
-proc statement(p: var Parser): PNode
 template initExpr(p: untyped): untyped = expression(p, 11)
 
 proc declKeyword(p: Parser, s: string): bool =
@@ -638,44 +773,111 @@ proc skipConst(p: var Parser): bool =
     if p.tok.s in ["const", "constexpr"]: result = true
     getTok(p, nil)
 
+proc cacheAngle(lt: ref Token; match: AngleMatch; closer: ref Token = nil) =
+  # tokens produced by a macro expansion are created anew every time the
+  # expansion is traversed, so nothing can be cached for them:
+  if not lt.fromMacro and (closer == nil or not closer.fromMacro):
+    lt.angle = match
+    lt.closer = closer
+
+proc resolveAngle(lt: ref Token): AngleMatch =
+  # applies the classification that is cached on `lt` to its closing token:
+  result = lt.angle
+  case result
+  of amUnknown, amNone: discard
+  of amClose:
+    if lt.closer.xkind == pxShr:
+      # the '>>' has not been split by the enclosing template yet:
+      result = amUnknown
+    else:
+      lt.closer.xkind = pxAngleRi
+  of amCloseSplit:
+    if lt.closer.xkind == pxShr:
+      lt.closer.xkind = pxAngleRi
+      insertAngleRi(lt.closer)
+
 proc isTemplateAngleBracket(p: var Parser): bool =
+  # The scan to the matching '>' classifies every nested '<' on the way
+  # too. The results are cached on the tokens, so that nested template
+  # arguments like ``map<string, vector<pair<int, int>>>`` are scanned only
+  # once instead of once per nesting level.
   if pfCpp notin p.options.flags: return false
+  let lt = p.tok
+  case resolveAngle(lt)
+  of amNone: return false
+  of amClose, amCloseSplit: return true
+  of amUnknown: discard
   saveContext(p)
   getTok(p, nil) # skip "<"
   var i: array[pxParLe..pxCurlyLe, int]
   var angles = 0
+  # the nested '<' and parentheses that are still open. As long as they are
+  # properly nested, a scan that starts at one of the '<' would come to the
+  # same result; otherwise they are dropped and classified on demand.
+  var pending: seq[ref Token] = @[]
+  var closer: ref Token = nil
+  var split = false
   while true:
     let kind = p.tok.xkind
     case kind
     of pxEof: break
-    of pxParLe, pxBracketLe, pxCurlyLe: inc(i[kind])
+    of pxParLe, pxBracketLe, pxCurlyLe:
+      inc(i[kind])
+      pending.add(p.tok)
     of pxGt, pxAngleRi:
       # end of arguments?
       if i[pxParLe] == 0 and i[pxBracketLe] == 0 and i[pxCurlyLe] == 0 and
           angles == 0:
         # mark as end token:
         p.tok.xkind = pxAngleRi
+        closer = p.tok
         result = true;
         break
       if angles > 0: dec(angles)
+      if pending.len > 0 and pending[^1].xkind == pxLt:
+        cacheAngle(pending.pop(), amClose, p.tok)
+      else:
+        pending.setLen(0)
     of pxShr:
       # >> can end a template too:
       if i[pxParLe] == 0 and i[pxBracketLe] == 0 and i[pxCurlyLe] == 0 and
           angles == 1:
+        if pending.len == 1 and pending[0].xkind == pxLt:
+          cacheAngle(pending[0], amClose, p.tok)
         p.tok.xkind = pxAngleRi
         insertAngleRi(p.tok)
+        closer = p.tok
+        split = true
         result = true
         break
       if angles > 1: dec(angles)
-    of pxLt: inc(angles)
+      if pending.len >= 2 and pending[^1].xkind == pxLt and pending[^2].xkind == pxLt:
+        cacheAngle(pending.pop(), amClose, p.tok)
+        cacheAngle(pending.pop(), amCloseSplit, p.tok)
+      pending.setLen(0)
+    of pxLt:
+      inc(angles)
+      pending.add(p.tok)
     of pxParRi, pxBracketRi, pxCurlyRi:
       let kind = pred(kind, 3)
+      if pending.len > 0 and pending[^1].xkind == kind:
+        discard pending.pop()
+      else:
+        if pending.len > 0 and pending[^1].xkind == pxLt:
+          cacheAngle(pending[^1], amNone)
+        pending.setLen(0)
       if i[kind] > 0: dec(i[kind])
       else: break
     of pxSemicolon, pxBarBar, pxAmpAmp: break
     else: discard
     getTok(p, nil)
+  if not result:
+    for t in pending:
+      if t.xkind == pxLt: cacheAngle(t, amNone)
   backtrackContext(p)
+  if not result: cacheAngle(lt, amNone)
+  elif split: cacheAngle(lt, amCloseSplit, closer)
+  else: cacheAngle(lt, amClose, closer)
 
 proc hasValue(t: StringTableRef, s: string): bool =
   for v in t.values:
@@ -1093,8 +1295,6 @@ proc parseBitfield(p: var Parser, i: PNode): PNode =
 
 import compiler/nimlexbase
 
-var cntAnonUnions = 0
-
 proc parseStructBody(p: var Parser, stmtList: PNode,
                      kind: TNodeKind = nkRecList): PNode =
   result = newNodeP(kind, p)
@@ -1131,7 +1331,7 @@ proc parseStructBody(p: var Parser, stmtList: PNode,
         var sstmts = newNodeP(nkStmtList, p)
         baseTyp = parseInnerStruct(p, sstmts, gotUnion, name)
         if gotUnion:
-          cntAnonUnions.inc()
+          inc(p.options.anonUnions)
         # handle anonymous unions / structs
         if p.tok.xkind == pxSemiColon:
           if pfAnonymousAsFields in p.options.flags:
@@ -1153,11 +1353,11 @@ proc parseStructBody(p: var Parser, stmtList: PNode,
                       if nameNode.kind == nkPostfix:
                         # postfix form like: name*
                         if not startsWith($(nameNode[1]), "ano_"):
-                          let name = "anon" & $cntAnonUnions & "_" & $nameNode[1]
+                          let name = "anon" & $p.options.anonUnions & "_" & $nameNode[1]
                           nameNode[1] = newIdentNodeP(name, p)
                       elif nameNode.kind == nkIdent:
                         if not startsWith($(nameNode), "ano_"):
-                          let name = "anon" & $cntAnonUnions & "_" & $nameNode
+                          let name = "anon" & $p.options.anonUnions & "_" & $nameNode
                           # Replace the ident in place
                           field[0] = newIdentNodeP(name, p)
                     result.add(field)
@@ -1511,38 +1711,60 @@ proc extractNumber(s: string, values: TableRef[string, BiggestInt] = nil): tuple
     result = (false, 0'i64)
 
 proc exprToNumber(n: PNode, values: TableRef[string, BiggestInt]): tuple[succ: bool, val: BiggestInt] =
-  result = (false, 0.BiggestInt)
-  case n.kind
-  of nkPrefix:
-    # Check for negative/positive numbers  -3  or  +6
-    if n.sons.len == 2 and n.sons[0].kind == nkIdent and n.sons[1].kind == nkIntLit:
-      let pre = n.sons[0]
-      let num = n.sons[1]
-      if pre.ident.s == "-":
-        result = extractNumber("-" & num.strVal, values)
-      elif pre.ident.s == "+":
-        result = extractNumber(num.strVal, values)
-  of nkIntLit..nkUInt64Lit:
-    result = extractNumber(n.strVal, values)
-  of nkCharLit:
-    result = (true, BiggestInt n.strVal[0])
-  of nkInfix:
-    let n1 = extractNumber($n[1], values)
-    let n2 = extractNumber($n[2], values)
-    case $n[0]
-    of "shl": result = (true, n1[1] shl n2[1])
-    of "shr": result = (true, n1[1] shr n2[1])
-    of "+": result = (true, n1[1] + n2[1])
-    of "-": result = (true, n1[1] - n2[1])
-    of "*": result = (true, n1[1] * n2[1])
-    of "/": result = (true, n1[1] div n2[1])
-  else: discard
+  # folds a constant expression; identifiers only resolve as operands, an
+  # identifier on its own is an alias:
+  proc eval(n: PNode; values: TableRef[string, BiggestInt];
+            val: var BiggestInt): bool =
+    case n.kind
+    of nkIntLit..nkUInt64Lit:
+      (result, val) = extractNumber(n.strVal)
+    of nkCharLit:
+      val = BiggestInt n.strVal[0]
+      result = true
+    of nkIdent:
+      result = values != nil and values.hasKey(n.ident.s)
+      if result: val = values[n.ident.s]
+    of nkPar:
+      result = n.len == 1 and eval(n[0], values, val)
+    of nkPrefix:
+      if n.len == 2 and n[0].kind == nkIdent and eval(n[1], values, val):
+        result = true
+        case n[0].ident.s
+        of "-": val = 0 -% val
+        of "+": discard
+        of "not": val = not val
+        else: result = false
+    of nkInfix:
+      # an operand that is not known counts as 0, so that a flag like
+      # '1 << UNKNOWN_SHIFT' is still sorted as a number:
+      var a, b: BiggestInt
+      if n.len == 3 and n[0].kind == nkIdent:
+        if not eval(n[1], values, a): a = 0
+        if not eval(n[2], values, b): b = 0
+        result = true
+        case n[0].ident.s
+        of "shl": val = a shl b
+        of "shr": val = a shr b
+        # wraps around like the C compiler's arithmetic instead of raising:
+        of "+": val = a +% b
+        of "-": val = a -% b
+        of "*": val = a *% b
+        of "div":
+          if b == 0 or (b == -1 and a == low(BiggestInt)): result = false
+          else: val = a div b
+        of "mod":
+          if b == 0 or (b == -1 and a == low(BiggestInt)): result = false
+          else: val = a mod b
+        of "and": val = a and b
+        of "or": val = a or b
+        of "xor": val = a xor b
+        else: result = false
+    else: result = false
 
-template any(x, cond: untyped): untyped =
-  var result = false
-  for it {.inject.} in x:
-    if cond: result = true; break
-  result
+  result = (false, 0.BiggestInt)
+  if n.kind != nkIdent:
+    result.succ = eval(n, values, result.val)
+    if not result.succ: result.val = 0
 
 proc getEnumIdent(n: PNode): PNode =
   if n.kind == nkEnumFieldDef: result = n[0]
@@ -1557,11 +1779,12 @@ proc enumFields(p: var Parser, constList, stmtList: PNode): PNode =
   type EnumFieldKind = enum isNormal, isNumber, isAlias
   result = newNodeP(nkEnumTy, p)
   addSon(result, emptyNode) # enum does not inherit from anything
-  var i: BiggestInt = 0
+  var i: BiggestInt = -1 # the first implicit value is 0
   var field: tuple[id: BiggestInt, kind: EnumFieldKind, node, value: PNode]
   var fields = newSeq[type(field)]()
   var fieldsComplete = false
   var fieldValues = newTable[string, BiggestInt]()
+  var fieldNames = initHashSet[string]()
   while p.tok.xkind != pxCurlyRi:
     if p.tok.xkind == pxDirective or p.tok.xkind == pxDirectiveParLe:
       var define = parseDir(p, statement)
@@ -1580,18 +1803,21 @@ proc enumFields(p: var Parser, constList, stmtList: PNode): PNode =
       skipCom(p, e)
       field.value = c
       var (success, number) = exprToNumber(c, fieldValues)
-      fieldValues[$a] = number
       if success:
         i = number
         field.kind = isNumber
-      elif any(fields,
-          c.kind == nkIdent and it.node.getEnumIdent.ident.s == c.ident.s):
+        fieldValues[a.ident.s] = number
+      elif c.kind == nkIdent and c.ident.s in fieldNames:
         field.kind = isAlias
+        if fieldValues.hasKey(c.ident.s):
+          fieldValues[a.ident.s] = fieldValues[c.ident.s]
       else:
         field.kind = isNormal
     else:
-      inc(i)
+      i = i +% 1
       field.kind = isNumber
+      fieldValues[e.ident.s] = i
+    fieldNames.incl getEnumIdent(e).ident.s
     field.id = i
     field.node = e
     fields.add(field)
@@ -2151,7 +2377,7 @@ proc declarationWithoutSemicolon(p: var Parser; genericParams: PNode = emptyNode
           doImport(origName, pragmas, p)
     of pxCurlyLe:
       if {pfCpp, pfKeepBodies} * p.options.flags == {pfCpp}:
-        discard compoundStatement(p)
+        discard skipBody(p)
         if pfCDecl in p.options.flags or pfImportc in p.options.flags:
           addSon(result, emptyNode)
         else:
@@ -2159,7 +2385,7 @@ proc declarationWithoutSemicolon(p: var Parser; genericParams: PNode = emptyNode
         addSon(result.lastSon, emptyNode)
       else:
         if pfImportc in p.options.flags:
-          discard compoundStatement(p)
+          discard skipBody(p)
           addSon(result, emptyNode)
         else:
           addSon(result, compoundStatement(p))
@@ -2843,13 +3069,39 @@ proc parseDoWhile(p: var Parser): PNode =
 
   addSon(result, stm)
 
+proc looksLikeDeclaration(p: Parser; leading: string): bool =
+  # `p.tok` is the token after the leading identifier (or qualified type).
+  case p.tok.xkind
+  of pxSymbol:
+    result = true
+  of pxStar, pxLt, pxAmp, pxAmpAmp:
+    # we parse
+    # a b
+    # a * b
+    # always as declarations! This is of course not correct, but good
+    # enough for most real world C code out there. Inside of function bodies
+    # the type table (if enabled) tells us what `a` is:
+    result = pfTypeTable notin p.options.flags or p.scopeCounter == 0 or
+             leading.len == 0 or isKnownType(p, leading)
+  else:
+    result = false
+
+proc startsWithKnownType(p: Parser): bool =
+  # a statement in a function body that starts with a known type is a
+  # declaration, so the lookahead is not needed. In C++ a qualified name
+  # like `T::member` can follow, so C++ still looks ahead:
+  result = pfTypeTable in p.options.flags and pfCpp notin p.options.flags and
+           p.scopeCounter > 0 and p.tok.xkind == pxSymbol and
+           isKnownType(p, p.tok.s)
+
 proc declarationOrStatement(p: var Parser): PNode =
   if p.tok.xkind != pxSymbol:
     result = expressionStatement(p)
-  elif declKeyword(p, p.tok.s):
+  elif declKeyword(p, p.tok.s) or startsWithKnownType(p):
     result = declaration(p)
   else:
     # ordinary identifier:
+    var leading = p.tok.s
     saveContext(p)
     getTok(p) # skip identifier to look ahead
 
@@ -2862,17 +3114,12 @@ proc declarationOrStatement(p: var Parser): PNode =
       if p.tok.s == "operator":
         backtrackContext(p)
         return declaration(p)
+      leading = ""
 
-    case p.tok.xkind
-    of pxSymbol, pxStar, pxLt, pxAmp, pxAmpAmp:
-      # we parse
-      # a b
-      # a * b
-      # always as declarations! This is of course not correct, but good
-      # enough for most real world C code out there.
+    if looksLikeDeclaration(p, leading):
       backtrackContext(p)
       result = declaration(p)
-    of pxColon:
+    elif p.tok.xkind == pxColon:
       # it is only a label:
       closeContext(p)
       getTok(p)
@@ -2939,6 +3186,9 @@ proc varDeclOrStatement(p: var Parser): PNode =
   of pxSemicolon:
     result = newNodeP(nkEmpty, p)
   of pxSymbol:
+    if startsWithKnownType(p):
+      return declarationWithoutSemicolon(p)
+    var leading = p.tok.s
     saveContext(p)
     getTok(p) # skip identifier to look ahead
 
@@ -2948,14 +3198,9 @@ proc varDeclOrStatement(p: var Parser): PNode =
       saveContext(p)
       let retType = typeAtom(p)
       discard pointer(p, retType)
+      leading = ""
 
-    case p.tok.xkind
-    of pxSymbol, pxStar, pxLt, pxAmp, pxAmpAmp:
-      # we parse
-      # a b
-      # a * b
-      # always as declarations! This is of course not correct, but good
-      # enough for most real world C code out there.
+    if looksLikeDeclaration(p, leading):
       backtrackContext(p)
       result = declarationWithoutSemicolon(p)
     else:
@@ -3206,9 +3451,10 @@ proc parseConstructor(p: var Parser, pragmas: PNode, isDestructor: bool;
   case p.tok.xkind
   of pxSemicolon: getTok(p)
   of pxCurlyLe:
-    let body = compoundStatement(p)
     if pfKeepBodies in p.options.flags:
-      result.sons[bodyPos] = body
+      result.sons[bodyPos] = compoundStatement(p)
+    else:
+      discard skipBody(p)
   of pxAsgn:
     # '= default;' C++11 defaulted constructor
     getTok(p)
@@ -3285,9 +3531,10 @@ proc parseMethod(p: var Parser, origName: string, rettyp, pragmas: PNode,
   case p.tok.xkind
   of pxSemicolon: getTok(p)
   of pxCurlyLe:
-    let body = compoundStatement(p)
     if pfKeepBodies in p.options.flags:
-      result.sons[bodyPos] = body
+      result.sons[bodyPos] = compoundStatement(p)
+    else:
+      discard skipBody(p)
   of pxAsgn:
     getTok(p)
     if p.tok.s == "delete":
@@ -3355,6 +3602,7 @@ proc parseTemplate(p: var Parser): PNode =
           if p.tok.xkind == pxSymbol and
               (p.tok.s == "class" or p.tok.s == "typename"):
                 getTok(p)
+                rememberTypeName(p)
                 var identDefs = newNodeP(nkIdentDefs, p)
                 identDefs.addSon(skipIdent(p, skType), emptyNode, emptyNode)
                 result.add identDefs
@@ -3908,37 +4156,52 @@ proc statement(p: var Parser): PNode =
     result = expressionStatement(p)
   assert result != nil
 
-proc parseStrict(p: var Parser): PNode =
-  try:
-    result = newNodeP(nkStmtList, p)
-    getTok(p) # read first token
-    while p.tok.xkind != pxEof:
-      var s = statement(p)
-      if s.kind != nkEmpty: embedStmts(result, s)
-  except ERetryParsing:
-    parError(p, getCurrentExceptionMsg())
-    # "Uncaught parsing exception raised")
-
-proc parseWithSyncPoints(p: var Parser): PNode =
-  result = newNodeP(nkStmtList, p)
-  getTok(p) # read first token
-  var firstError = ""
-  while p.tok.xkind != pxEof:
+proc traceStatement(p: Parser; s: PNode; line: int; start: float) =
+  # one span per top level statement:
+  if gTracing:
+    traceSpan(declLabel(s) & " " & p.header & "(" & $line & ")", "statement",
+              start)
+
+proc nextStatement(p: var Parser; list: PNode) =
+  # parses the next top level statement into `list`. Without --strict a
+  # statement that does not parse is skipped up to the next sync point,
+  # which is a not-nested ';'. With --strict the exception goes through:
+  let line = p.tok.lineNumber
+  let start = traceNow()
+  var s: PNode
+  if pfStrict in p.options.flags:
+    s = statement(p)
+    if s.kind != nkEmpty: embedStmts(list, s)
+  else:
     saveContextB(p, true)
     try:
-      var s = statement(p)
-      if s.kind != nkEmpty:
-        embedStmts(result, s)
+      s = statement(p)
+      if s.kind != nkEmpty: embedStmts(list, s)
       closeContextB(p)
     except ERetryParsing:
-      let err = getCurrentExceptionMsg()
-      if firstError.len == 0: firstError = err
       backtrackContextB(p)
-      # skip to the next sync point (which is a not-nested ';')
-      result.add skipToSemicolon(p, err, exitForCurlyRi=false)
+      s = skipToSemicolon(p, getCurrentExceptionMsg(), exitForCurlyRi=false)
+      list.add s
+  traceStatement(p, s, line, start)
 
 proc parseUnit*(p: var Parser): PNode =
-  if pfStrict in p.options.flags:
-    result = parseStrict(p)
-  else:
-    result = parseWithSyncPoints(p)
+  result = newNodeP(nkStmtList, p)
+  getTok(p) # read first token
+  try:
+    while p.tok.xkind != pxEof: nextStatement(p, result)
+  except ERetryParsing:
+    parError(p, getCurrentExceptionMsg())
+
+proc parseStatements*(p: var Parser; emit: proc (n: PNode) {.closure.}) =
+  ## Like `parseUnit` but passes every top level statement to `emit` as
+  ## soon as it is parsed, so that the caller can process and release it.
+  getTok(p) # read first token
+  try:
+    while p.tok.xkind != pxEof:
+      var list = newNodeP(nkStmtList, p)
+      nextStatement(p, list)
+      if list.len > 0: emit(list)
+  except ERetryParsing:
+    parError(p, getCurrentExceptionMsg())
+
+include parallel
@@ -60,25 +60,97 @@ proc nep1(s: string, k: TSymKind): string =
       result.add s[i]
     inc i
 
+proc firstChars(p: Peg): tuple[chars: set[char], canBeEmpty: bool] =
+  # the characters a match of `p` can start with; conservative for the
+  # constructs that are not analysed:
+  case p.kind
+  of pkTerminal:
+    if p.term.len > 0: result = ({p.term[0]}, false)
+    else: result = ({}, true)
+  of pkTerminalIgnoreCase:
+    if p.term.len > 0:
+      result = ({toLowerAscii(p.term[0]), toUpperAscii(p.term[0])}, false)
+    else: result = ({}, true)
+  of pkChar: result = ({p.ch}, false)
+  of pkCharChoice: result = (p.charChoice[], false)
+  of pkGreedyRepChar: result = ({p.ch}, true)
+  of pkGreedyRepSet: result = (p.charChoice[], true)
+  of pkCapture:
+    for x in p: return firstChars(x)
+  of pkOption, pkGreedyRep:
+    for x in p: return (firstChars(x).chars, true)
+  of pkStartAnchor, pkAndPredicate, pkNotPredicate:
+    # these do not consume anything:
+    result = ({}, true)
+  of pkSequence:
+    result = ({}, true)
+    for x in p:
+      let f = firstChars(x)
+      result.chars = result.chars + f.chars
+      if not f.canBeEmpty:
+        result.canBeEmpty = false
+        break
+  of pkOrderedChoice:
+    result = ({}, false)
+    for x in p:
+      let f = firstChars(x)
+      result.chars = result.chars + f.chars
+      result.canBeEmpty = result.canBeEmpty or f.canBeEmpty
+  else:
+    result = ({low(char)..high(char)}, true)
+
+proc buildMangleIndex(o: PParserOptions) =
+  # buckets the rules by the first (for suffixes: last) character of the
+  # names they can apply to; every bucket keeps the order of the rules:
+  for c in low(char)..high(char):
+    setLen(o.mangleIndex.rules[c], 0)
+    setLen(o.mangleIndex.prefixes[c], 0)
+    setLen(o.mangleIndex.suffixes[c], 0)
+  setLen(o.mangleIndex.emptyRules, 0)
+  for i, rule in o.mangleRules:
+    let f = firstChars(rule.pattern)
+    if f.canBeEmpty: o.mangleIndex.emptyRules.add i
+    for c in low(char)..high(char):
+      if f.canBeEmpty or c in f.chars: o.mangleIndex.rules[c].add i
+  for i, prefix in o.prefixes:
+    for c in low(char)..high(char):
+      if prefix.len == 0 or prefix[0] == c: o.mangleIndex.prefixes[c].add i
+  for i, suffix in o.suffixes:
+    for c in low(char)..high(char):
+      if suffix.len == 0 or suffix[^1] == c: o.mangleIndex.suffixes[c].add i
+  o.mangleIndex.valid = true
+
 proc mangleRules(s: string, p: Parser; kind: TSymKind): string =
+  let o = p.options
+  if not o.mangleIndex.valid: buildMangleIndex(o)
   block mangle:
     result = s
-    for pattern, frmt in items(p.options.mangleRules):
-      if result.match(pattern):
-        result = result.replacef(pattern, frmt)
-        if pfNoMultiMangle in p.options.flags:
+    # the rules apply in order and each one sees the result of the previous
+    # ones, so the bucket changes with the first character of the result:
+    var next = 0
+    while true:
+      # a rule can rewrite the name to "" and the later ones still apply:
+      let bucket = if result.len > 0: addr(o.mangleIndex.rules[result[0]])
+                   else: addr(o.mangleIndex.emptyRules)
+      let k = lowerBound(bucket[], next)
+      if k >= bucket[].len: break
+      let i = bucket[][k]
+      if result.match(o.mangleRules[i].pattern):
+        result = result.replacef(o.mangleRules[i].pattern, o.mangleRules[i].frmt)
+        if pfNoMultiMangle in o.flags:
           break mangle
-    block prefixes:
-      for prefix in items(p.options.prefixes):
-        if result.startsWith(prefix):
-          result = result.substr(prefix.len)
-          break prefixes
-    block suffixes:
-      for suffix in items(p.options.suffixes):
-        if result.endsWith(suffix):
-          setLen(result, result.len - suffix.len)
-          break suffixes
-    if p.options.followNep1 and kind != skDontMangle:
+      next = i+1
+    if result.len > 0:
+      for i in o.mangleIndex.prefixes[result[0]]:
+        if result.startsWith(o.prefixes[i]):
+          result = result.substr(o.prefixes[i].len)
+          break
+    if result.len > 0:
+      for i in o.mangleIndex.suffixes[result[^1]]:
+        if result.endsWith(o.suffixes[i]):
+          setLen(result, result.len - o.suffixes[i].len)
+          break
+    if o.followNep1 and kind != skDontMangle:
       result = nep1(result, kind)
 
 proc mangleName(s: string, p: Parser; kind: TSymKind): string =
@@ -86,12 +158,25 @@ proc mangleName(s: string, p: Parser; kind: TSymKind): string =
   else: result = mangleRules(s, p, kind)
 
 proc isPrivate(s: string, p: Parser): bool =
+  if p.options.privateRules.len == 0: return false
+  if p.options.privates.hasKey(s): return p.options.privates[s]
   for pattern in items(p.options.privateRules):
-    if s.match(pattern): return true
+    if s.match(pattern):
+      result = true
+      break
+  p.options.privates[s] = result
 
 proc mangledIdent(ident: string, p: Parser; kind: TSymKind): PNode =
   result = newNodeP(nkIdent, p)
-  result.ident = getIdent(mangleName(ident, p, kind))
+  if p.options.toMangle.hasKey(ident):
+    result.ident = getIdent(p.options.toMangle[ident])
+  else:
+    # the rules are the same for every occurrence, so they are applied once
+    # per identifier and kind:
+    result.ident = p.options.mangled[kind].getOrDefault(ident)
+    if result.ident.isNil:
+      result.ident = getIdent(mangleRules(ident, p, kind))
+      p.options.mangled[kind][ident] = result.ident
 
 proc getHeaderPair(p: Parser): PNode =
   let pre = p.options.headerPrefix
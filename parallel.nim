@@ -0,0 +1,345 @@
+#
+#
+#      c2nim - C to Nim source converter
+#        (c) Copyright 2015 Andreas Rumpf
+#
+#    See the file "copying.txt", included in this
+#    distribution, for details about the copyright.
+#
+
+# Parallel parsing of a single file: A raw pre-scan splits the file into
+# regions of top-level declarations. Every region gets its own parser and its
+# own copy of the parser options and is parsed on a worker thread; the
+# resulting statement lists are merged in source order.
+#
+# The regions must not depend on each other. The pre-scan gives up on files
+# that contain directives which change the options, and if parsing a region
+# records state that later regions could see (a macro, a class, a mangled
+# name, an anonymous type counter) the result is thrown away and the caller
+# parses the file sequentially. So is the result if a region has an error:
+# the regions' lexers are quiet, they raise instead of reporting errors and
+# keep their warnings until the result is accepted. This file is included by cparser.nim.
+
+when compileOption("threads") and (NimMajor, NimMinor) >= (2, 0):
+  import std/typedthreads
+
+const
+  ParallelParsing* = compileOption("threads") and defined(gcAtomicArc)
+    ## the worker threads share the identifiers and parts of the options;
+    ## only atomic reference counting makes that safe
+  MinRegionSize {.intdefine.} = 32 * 1024
+    ## smaller regions are not worth a thread
+
+type
+  RegionStart = tuple[pos, line: int]
+
+  RegionJob = object
+    p: Parser
+    tree: PNode
+    failed: bool
+
+proc skipRawComment(s: string; i, line: var int) =
+  # 'i' is at "/*":
+  inc(i, 2)
+  while i < s.len:
+    if s[i] == '*' and i+1 < s.len and s[i+1] == '/':
+      inc(i, 2)
+      return
+    if s[i] == '\L': inc(line)
+    inc(i)
+
+proc skipRawLiteral(s: string; i, line: var int) =
+  # 'i' is at the opening quote:
+  let quote = s[i]
+  inc(i)
+  while i < s.len and s[i] notin {quote, '\L'}:
+    if s[i] == '\\' and i+1 < s.len:
+      if s[i+1] == '\L': inc(line)
+      inc(i)
+    inc(i)
+  if i < s.len and s[i] == quote: inc(i)
+
+proc skipRawNumber(s: string; i: var int) =
+  # 'i' is at the digit that starts a number. Like the lexer a quote after
+  # a digit is a digit separator, as in 100'000:
+  inc(i)
+  while i < s.len:
+    if s[i] in SymChars + {'.'}: inc(i)
+    elif s[i] == '\'' and s[i-1] in SymChars: inc(i)
+    else: break
+
+proc startsNumber(s: string; i: int): bool =
+  result = s[i] in {'0'..'9'} and (i == 0 or s[i-1] notin SymChars)
+
+proc rawIdent(s: string; i: var int): string =
+  while i < s.len and s[i] in {' ', '\t'}: inc(i)
+  let start = i
+  while i < s.len and s[i] in SymChars: inc(i)
+  result = substr(s, start, i-1)
+
+proc skipRawLine(s: string; i, line: var int) =
+  # skips the rest of a line; for directives with their continuation lines:
+  while i < s.len and s[i] != '\L':
+    case s[i]
+    of '\\':
+      inc(i)
+      if i < s.len and s[i] == '\r': inc(i)
+      if i < s.len and s[i] == '\L':
+        inc(line)
+        inc(i)
+    of '/':
+      if i+1 < s.len and s[i+1] == '*': skipRawComment(s, i, line)
+      elif i+1 < s.len and s[i+1] == '/':
+        while i < s.len and s[i] != '\L': inc(i)
+      else: inc(i)
+    of '"', '\'': skipRawLiteral(s, i, line)
+    of '0'..'9':
+      if startsNumber(s, i): skipRawNumber(s, i)
+      else: inc(i)
+    else: inc(i)
+  if i < s.len:
+    inc(i)
+    inc(line)
+
+proc isBlankRest(s: string; i: int): bool =
+  # only whitespace or a comment until the end of the line?
+  var i = i
+  while i < s.len and s[i] in {' ', '\t', '\r'}: inc(i)
+  result = i >= s.len or s[i] == '\L' or
+    (s[i] == '/' and i+1 < s.len and s[i+1] in {'/', '*'})
+
+proc nextIsDefine(s: string; i: int): bool =
+  # is the next directive after blank lines a '#define'?
+  var i = i
+  while i < s.len and s[i] in Whitespace: inc(i)
+  if i < s.len and s[i] == '#':
+    inc(i)
+    result = rawIdent(s, i) == "define"
+
+proc lineEnd(s: string; i: int): int =
+  result = i
+  while result < s.len and s[result] != '\L': inc(result)
+
+proc rawDefines(o: PParserOptions; name: string): bool =
+  # mirrors 'defines' for the pre-scan:
+  if o.assumeDef.contains(name): return true
+  for m in o.macros:
+    if m.name == name: return true
+
+proc scanRegions(s: var string; o: PParserOptions): seq[RegionStart] =
+  ## Returns the line starts at which the file can be split into regions;
+  ## that is wherever a declaration or directive ends outside of any
+  ## brackets and ``#if`` sections. The result is empty if the file uses
+  ## directives that change the options for the rest of the file. Top-level
+  ## include guards are blanked out of `s`, so that their content can be
+  ## split too; c2nim translates their content as if there was no guard.
+  result = @[]
+  var i = 0
+  var line = 1
+  var depth = 0         # nesting of (), [] and {}
+  var conds = 0         # nesting of #if sections
+  var guard = 0         # 1 inside of a top-level include guard
+  var skipped = 0       # > 0: the level of an #if section that c2nim skips
+  var endOfUnit = true  # the last token ended a declaration
+  var inDefines = false # the last directive was a '#define'; the parser
+                        # puts the next '#define' into the same section
+  var blanks: seq[tuple[a, b: int]] = @[]
+  while i < s.len:
+    if i > 0 and depth == 0 and conds == guard and skipped == 0 and
+        endOfUnit and not (inDefines and nextIsDefine(s, i)):
+      result.add((i, line))
+    var j = i
+    while j < s.len and s[j] in {' ', '\t', '\r'}: inc(j)
+    if j < s.len and s[j] == '#':
+      let lineStart = i
+      i = j+1
+      let dir = rawIdent(s, i)
+      inDefines = dir == "define"
+      case dir
+      of "if", "ifdef", "ifndef":
+        let arg = rawIdent(s, i)
+        inc(conds)
+        if skipped > 0: discard
+        elif (dir == "ifdef" and o.assumenDef.contains(arg)) or
+            (dir == "ifndef" and rawDefines(o, arg)):
+          skipped = conds
+        elif dir == "ifndef" and conds == 1 and depth == 0 and
+            isBlankRest(s, i):
+          # an include guard needs a '#define' of the same symbol next:
+          var k = i
+          var ignored = line
+          skipRawLine(s, k, ignored)
+          while k < s.len and s[k] in Whitespace: inc(k)
+          if k < s.len and s[k] == '#':
+            inc(k)
+            if rawIdent(s, k) == "define" and rawIdent(s, k) == arg and
+                isBlankRest(s, k):
+              guard = 1
+              blanks.add((lineStart, lineEnd(s, k)))
+      of "else", "elif": discard
+      of "endif":
+        if conds == 0: return @[]
+        if skipped == conds: skipped = 0
+        elif conds == guard:
+          guard = 0
+          blanks.add((lineStart, lineEnd(s, i)))
+        dec(conds)
+      of "", "include", "define", "undef", "error", "warning", "line": discard
+      of "pragma":
+        if skipped == 0 and rawIdent(s, i) == "c2nim": return @[]
+      else:
+        # a c2nim directive:
+        if skipped == 0: return @[]
+      skipRawLine(s, i, line)
+      continue
+    if not isBlankRest(s, j): inDefines = false
+    while i < s.len and s[i] != '\L':
+      case s[i]
+      of ' ', '\t', '\r', '\\':
+        inc(i)
+      of '/':
+        if i+1 < s.len and s[i+1] == '*':
+          skipRawComment(s, i, line)
+        elif i+1 < s.len and s[i+1] == '/':
+          while i < s.len and s[i] != '\L': inc(i)
+        else:
+          if skipped == 0: endOfUnit = false
+          inc(i)
+      of '"', '\'':
+        if skipped == 0: endOfUnit = false
+        skipRawLiteral(s, i, line)
+      of '(', '[', '{':
+        if skipped == 0:
+          inc(depth)
+          endOfUnit = false
+        inc(i)
+      of ')', ']', '}':
+        if skipped == 0:
+          if depth > 0: dec(depth)
+          endOfUnit = false
+        inc(i)
+      of ';':
+        if skipped == 0: endOfUnit = depth == 0
+        inc(i)
+      of '0'..'9':
+        if skipped == 0: endOfUnit = false
+        if startsNumber(s, i): skipRawNumber(s, i)
+        else: inc(i)
+      else:
+        if skipped == 0: endOfUnit = false
+        inc(i)
+    if i < s.len:
+      inc(i)
+      inc(line)
+  if conds != 0 or depth != 0: return @[]
+  for b in blanks:
+    for k in b.a ..< b.b:
+      if s[k] != '\L': s[k] = ' '
+
+proc copyTable(t: StringTableRef): StringTableRef =
+  result = newStringTable(modeCaseSensitive)
+  for key, val in pairs(t): result[key] = val
+
+proc regionOptions(o: PParserOptions): PParserOptions =
+  # a region's own copy of everything the parser can change. Macro bodies
+  # are copied too, as every expansion relinks their tokens:
+  result = PParserOptions()
+  result[] = o[]
+  result.toMangle = copyTable(o.toMangle)
+  result.classes = copyTable(o.classes)
+  result.knownTypes = copyTable(o.knownTypes)
+  for m in mitems(result.macros):
+    var body = newSeq[ref Token](m.body.len)
+    for i, t in m.body:
+      new(body[i])
+      body[i][] = t[]
+      body[i].next = nil
+    m.body = body
+
+proc stateSize(o: PParserOptions): int =
+  # grows whenever parsing records something later regions could depend on:
+  o.macros.len + o.toMangle.len + o.classes.len + o.knownTypes.len +
+    o.anonUnions
+
+proc hasIgnoredConstruct(n: PNode): bool =
+  for x in n:
+    if x.kind == nkCommentStmt and x.comment.startsWith("!!!Ignored construct"):
+      return true
+
+proc independent(jobs: seq[RegionJob]; stateBefore: int): bool =
+  # the regions must not depend on each other:
+  result = true
+  var anonymousTypes = false
+  for r in 0 ..< jobs.len:
+    if jobs[r].failed or hasIgnoredConstruct(jobs[r].tree): return false
+    if r < jobs.high and stateSize(jobs[r].p.options) != stateBefore:
+      return false
+    if jobs[r].p.anoTypeCount > 0:
+      # the names of anonymous types are numbered per file:
+      if anonymousTypes: return false
+      anonymousTypes = true
+
+when ParallelParsing:
+  proc parseRegion(job: ptr RegionJob) {.thread.} =
+    {.cast(gcsafe).}:
+      try:
+        job.tree = parseUnit(job.p)
+      except CatchableError:
+        job.failed = true
+
+proc parseRegions*(filename: string; options: PParserOptions): PNode =
+  ## Parses `filename` in regions on up to ``options.workers`` threads.
+  ## Returns nil if the file has to be parsed sequentially.
+  result = nil
+  when ParallelParsing:
+    if options.workers <= 1 or options.profileBacktracks or
+        {pfCpp, pfTypePrefixes, pfTypeTable} * options.flags != {}:
+      return
+    var content = readFile(filename)
+    let cuts = scanRegions(content, options)
+    let n = min(options.workers, content.len div MinRegionSize)
+    if n <= 1 or cuts.len == 0: return
+    # pick the cuts that divide the file into regions of similar size:
+    var starts: seq[RegionStart] = @[(0, 1)]
+    var k = 0
+    for r in 1 ..< n:
+      let target = content.len * r div n
+      while k < cuts.len and cuts[k].pos < target: inc(k)
+      if k == cuts.len: break
+      if cuts[k].pos > starts[^1].pos: starts.add(cuts[k])
+    if starts.len <= 1: return
+    var jobs = newSeq[RegionJob](starts.len)
+    for r in 0 ..< jobs.len:
+      let last = if r+1 < starts.len: starts[r+1].pos else: content.len
+      openParser(jobs[r].p, filename,
+                 llStreamOpen(substr(content, starts[r].pos, last-1)),
+                 regionOptions(options))
+      jobs[r].p.lex.lineNumber = starts[r].line
+      # an error must not end the program; the file is parsed again:
+      new(jobs[r].p.lex.quiet)
+    let mark = traceMark()
+    var threads = newSeq[Thread[ptr RegionJob]](jobs.len)
+    for r in 0 ..< jobs.len:
+      createThread(threads[r], parseRegion, addr(jobs[r]))
+    joinThreads(threads)
+    let lines = gLinesCompiled
+    let tokens = gTokensLexed
+    let backtracks = gBacktracks
+    for r in 0 ..< jobs.len: closeParser(jobs[r].p)
+    gLinesCompiled = lines
+    gTokensLexed = tokens
+    gBacktracks = backtracks
+    if not independent(jobs, stateSize(options)):
+      # the file is parsed again; the spans of the regions would show the
+      # statements twice:
+      traceDiscard(mark)
+      return
+    for r in 0 ..< jobs.len: replayMessages(jobs[r].p.lex)
+    result = jobs[0].tree
+    for r in 1 ..< jobs.len:
+      for x in jobs[r].tree: result.add(x)
+    options[] = jobs[^1].p.options[]
+    inc(gLinesCompiled, jobs[^1].p.lex.lineNumber)
+    for r in 0 ..< jobs.len:
+      inc(gTokensLexed, jobs[r].p.lex.tokens)
+      inc(gBacktracks, jobs[r].p.backtracks)
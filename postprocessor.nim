@@ -13,13 +13,16 @@
 ## - Fixes some empty statement sections.
 ## - Tries to rewrite braced initializers to be more accurate.
 
-import std / [tables, sets, strutils]
+import std / [tables, sets, strutils, hashes]
 from macros import eqIdent
 
 import compiler/[ast, renderer, idents]
 
 import clexer
-from cparser import ParserFlag, dumpTree
+from cparser import ParserFlag, dumpTree, ParallelParsing
+
+when compileOption("threads") and (NimMajor, NimMinor) >= (2, 0):
+  import std/typedthreads
 
 template emptyNode: untyped = newNode(nkEmpty)
 
@@ -27,14 +30,18 @@ proc isEmptyStmtList(n: PNode): bool =
   result = n.kind == nkStmtList and n.len == 1 and n[0].kind == nkEmpty
 
 type
-  Context = object
+  Context* = object
     typedefs: Table[string, PNode]
     deletes: Table[string, string]
     structStructMode: bool
+    cpp: bool
     reorderComments: bool
     reorderTypes: bool
     mergeBlocks: bool
     mergeDuplicates: bool
+    deletesDefs: bool # some --delete names a whole rendered proc
+    deferred: bool # record typedefs and bracket patches for 'replay'
+    events: seq[tuple[name: string, n: PNode]] # an empty name: a patch
 
 proc getName(n: PNode): PNode =
   result = n
@@ -52,22 +59,26 @@ proc count(n: PNode): int =
   for i in 0..<safeLen(n):
     inc result, count(n[i])
 
+proc rememberTypedef(c: var Context; name: string; n: PNode) =
+  if not c.structStructMode:
+    c.typedefs[name] = n
+  else:
+    let oldDef = c.typedefs.getOrDefault(name)
+    if oldDef == nil:
+      c.typedefs[name] = n
+    else:
+      # check which declaration is the better one:
+      if count(n.lastSon) > count(oldDef.lastSon):
+        oldDef.kind = nkEmpty # remove it
+        c.typedefs[name] = n
+      else:
+        n.kind = nkEmpty # remove this one
+
 proc rememberTypedef(c: var Context; n: PNode) =
   let name = getName(n[0])
   if name.kind == nkIdent and n.len >= 2:
-    if not c.structStructMode:
-      c.typedefs[name.ident.s] = n
-    else:
-      let oldDef = c.typedefs.getOrDefault(name.ident.s)
-      if oldDef == nil:
-        c.typedefs[name.ident.s] = n
-      else:
-        # check which declaration is the better one:
-        if count(n.lastSon) > count(oldDef.lastSon):
-          oldDef.kind = nkEmpty # remove it
-          c.typedefs[name.ident.s] = n
-        else:
-          n.kind = nkEmpty # remove this one
+    if c.deferred: c.events.add((name.ident.s, n))
+    else: rememberTypedef(c, name.ident.s, n)
 
 proc ithFieldName(t: PNode; position: var int): PNode =
   result = nil
@@ -123,32 +134,42 @@ proc patchBracket(c: Context; t: PNode; n: var PNode) =
 
 import sequtils
 
-var depth = 0
-
 proc reorderComments(n: PNode) = 
-  ## reorder C style comments to Nim style ones
-  var j = 1
+  ## reorder C style comments to Nim style ones: a comment on the line of
+  ## the declaration before it and a comment before a declaration become
+  ## the declaration's comment. The comment before a declaration wins. The
+  ## surviving children are compacted in one sweep.
   let commentKinds = {nkTypeSection, nkIdentDefs, nkProcDef, nkConstSection, nkVarSection}
-  template moveComment(idx, off) =
-    if n[idx+off].len > 0:
-      n[idx+off][0].comment = n[idx].comment
-      delete(n.sons, idx)
-  
-  while j < n.safeLen - 1:
-    if n[j].kind == nkCommentStmt:
-      # join comments to previous node if line numbers match
-      if n[j-1].kind in commentKinds:
-        if n[j-1].info.line == n[j].info.line:
-          moveComment(j, -1)
-    inc j
-  
-  var i = 0
-  while i < n.safeLen - 1:
-    if n[i].kind == nkCommentStmt:
-      # reorder comments to match Nim ordering
-      if n[i+1].kind in commentKinds:
-        moveComment(i, +1)
-    inc i
+  if n.safeLen < 2: return
+  var k = 0
+  var prev: PNode = nil
+  var prevJoined = false  # was the previous child joined to its predecessor?
+  var prevLeading = false # did the previous child get the comment before it?
+  var leading = false     # did the current child get the comment before it?
+  for i in 0 ..< n.len:
+    let x = n[i]
+    let isLeading = leading
+    leading = false
+    var keep = true
+    if x.kind == nkCommentStmt:
+      if i < n.len - 1 and prev != nil and not prevJoined and
+          prev.kind in commentKinds and prev.info.line == x.info.line and
+          prev.len > 0:
+        # join comments to previous node if line numbers match
+        if not prevLeading: prev[0].comment = x.comment
+        keep = false
+      elif i < n.len - 1 and n[i+1].kind in commentKinds and n[i+1].len > 0:
+        # reorder comments to match Nim ordering
+        n[i+1][0].comment = x.comment
+        leading = true
+        keep = false
+    prevJoined = not keep and not leading
+    prevLeading = isLeading
+    prev = x
+    if keep:
+      n.sons[k] = x
+      inc k
+  setLen(n.sons, k)
 
 proc removeBlankSections(n: var PNode) =
   if n.kind in {nkLetSection, nkTypeSection, nkVarSection, nkImportStmt}:
@@ -175,12 +196,6 @@ proc hasIdentChildren(n: PNode): bool =
       if hasIdentChildren(c):
         return true
 
-proc findMax(n: Pnode, kd: TNodeKind, stop: int = int.high): int =
-  result = -1
-  for i in countup(0, n.safeLen()-1):
-    if n[i].kind == kd: result = max(i, result)
-    if i >= stop: return
-
 proc findMin(n: Pnode, kd: TNodeKind, start: int = 0): int =
   result = int.high
   for i in countdown(n.safeLen()-1, 0):
@@ -191,160 +206,204 @@ proc findMin(n: Pnode, kd: TNodeKind, start: int = 0): int =
 
 proc reorderTypes(n: PNode) = 
   ## reorder C types to be at start of file
-  
-  block:
-    # reorder type sections
-    # find first type section
-    # then move all type sections after it
-    let firstTypeSection = n.findMin(nkTypeSection)
-    var i = n.len - 1
-    var typeSections: seq[PNode]
-    while i > max(firstTypeSection, 0):
-      if n[i].kind == nkTypeSection:
-        typeSections.add(n[i])
-        n.delSon(i)
-      dec(i)
-
-    for st in typeSections:
-      n.sons.insert(st, firstTypeSection+1)
-
-  var constSections: seq[PNode]
-
-  block:
-    # adjust const nodes after the inserts
-    # find any normal const sections
-    var j = n.safeLen - 1
-    while j > 0:
-      if n[j].kind == nkConstSection:
-        constSections.add(n[j])
-        n.delSon(j)
-      dec(j)
-
-  block:
-    # reorder const sections
-    let firstTypeSection = n.findMin(nkTypeSection)
-    if firstTypeSection == -1:
-      return
-
-    n.sons.insert(nkConstSection.newTree(), firstTypeSection)
-
-    let postTypeSection = n.findMax(nkTypeSection) + 1
-    n.sons.insert(nkConstSection.newTree(), postTypeSection)
-
-  block:
-    let firstTypeSection = n.findMin(nkTypeSection)
-    let constPreTypes = n.findMax(nkConstSection, firstTypeSection)
-    let constPostTypes = n.findMax(nkConstSection)
-    assert constPreTypes != constPostTypes
-
-    for sect in constSections:
-      for cnode in sect:
-        let litType = not cnode[^1].hasIdentChildren()
-        # echo "CONST NODE: ", " valKind: ", litType, " childIdent: ", hasIdentChildren(cnode[^1])
-        # dumpTree(cnode[^1])
-
-        if litType:
-          n[constPreTypes].sons.insert(cnode,0)
-        else:
-          n[constPostTypes].sons.insert(cnode,0)
+  ##
+  ## A stable partition that is rebuilt once: what comes before the first
+  ## type section stays in front, followed by a const section with the
+  ## literal constants, all type sections, a const section with the other
+  ## constants and the rest.
+  let firstTypeSection = n.findMin(nkTypeSection)
+  if firstTypeSection == -1:
+    return
+
+  var before, types, rest, constSections: seq[PNode]
+  for i in 0 ..< n.len:
+    let x = n[i]
+    if x.kind == nkTypeSection: types.add(x)
+    elif x.kind == nkConstSection and i > 0: constSections.add(x)
+    elif i < firstTypeSection: before.add(x)
+    else: rest.add(x)
+
+  var constPreTypes = nkConstSection.newTree()
+  var constPostTypes = nkConstSection.newTree()
+  for sect in constSections:
+    # the constants of a section end up in reverse order:
+    for j in countdown(sect.len-1, 0):
+      let cnode = sect[j]
+      let litType = not cnode[^1].hasIdentChildren()
+      # echo "CONST NODE: ", " valKind: ", litType, " childIdent: ", hasIdentChildren(cnode[^1])
+      # dumpTree(cnode[^1])
+
+      if litType:
+        constPreTypes.add(cnode)
+      else:
+        constPostTypes.add(cnode)
 
+  n.sons = before
+  n.add(constPreTypes)
+  for x in types: n.add(x)
+  n.add(constPostTypes)
+  for x in rest: n.add(x)
 
 proc mergeSimilarBlocks(n: PNode) = 
   ## merge similar types of blocks
   ## 
   let blockKinds = {nkTypeSection, nkConstSection, nkVarSection}
-  template moveBlock(idx, prev) =
-    for ch in n[idx]:
-      n[prev].add(newNode(nkStmtList))
-      n[prev].add(ch)
-    delete(n.sons, idx)
-  
-  var i = 0
-  while i < n.safeLen - 1:
-    let kind = n[i].kind
-    if kind in blockKinds:
-      if n[i+1].kind == kind:
-        moveBlock(i+1, i)
-        continue
-    inc i
- 
-template checkDuplicate(n, def: untyped) =
-  let ndef = nimIdentNormalize(def)
-  if ndef in duplicateNodeCheck:
-    let idx = duplicateNodeCheck[ndef]
-    if idx != n[i].info.line.int:
-      # echo "DEL:DUPE: ", "idx: ", idx, " n.idx: ", n[i].info.line, " def: ", def
-      delete(n.sons, i)
-      continue
-  else:
-    duplicateNodeCheck[ndef] = n[i].info.line.int
+  if n.safeLen < 2: return
+  # compact the surviving blocks in one sweep:
+  var k = 0
+  for i in 0 ..< n.len:
+    let x = n[i]
+    if k > 0 and x.kind in blockKinds and n[k-1].kind == x.kind:
+      for ch in x:
+        n[k-1].add(newNode(nkStmtList))
+        n[k-1].add(ch)
+    else:
+      n.sons[k] = x
+      inc k
+  setLen(n.sons, k)
+
+proc nameText(n: PNode): string =
+  ## the text ``$n`` renders for a name, computed without the renderer.
+  ## Falls back to rendering for anything that is not a plain name.
+  case n.kind
+  of nkIdent:
+    if n.comment.len == 0: return n.ident.s
+  of nkAccQuoted:
+    if n.comment.len == 0 and n.len > 0:
+      result = "`"
+      for i in 0 ..< n.len:
+        if n[i].kind != nkIdent or n[i].comment.len > 0: return $n
+        if i > 0: result.add ' '
+        result.add n[i].ident.s
+      result.add '`'
+      return
+  of nkPostfix:
+    if n.comment.len == 0 and n.len == 2 and n[0].kind == nkIdent and
+        n[0].comment.len == 0 and n[1].kind in {nkIdent, nkAccQuoted}:
+      return nameText(n[1]) & n[0].ident.s
+  else: discard
+  result = $n
 
 proc identName(n: PNode): string =
-  if n.kind == nkPostFix: return $n[^1] else: result = $n
+  if n.kind == nkPostFix: return nameText(n[^1]) else: result = nameText(n)
+
+proc declName(n: PNode): string =
+  ## the name of a variable as ``split($n, "*")[0]`` yields it
+  var n = n
+  if n.kind == nkPragmaExpr and n[0].kind == nkPostfix: n = n[0]
+  if n.kind == nkPostfix and n.comment.len == 0: n = n[1]
+  result = split(nameText(n), "*")[0]
+
+proc sameName(a, b: PNode): bool =
+  # only names render to the text of a name:
+  const nameKinds = {nkIdent, nkAccQuoted, nkPostfix}
+  result = a.kind in nameKinds and b.kind in nameKinds and
+    cmpIgnoreStyle(identName(a), identName(b)) == 0
+
+proc hashDef(n: PNode): Hash =
+  ## agrees with `sameDef`
+  var h: Hash = ord(n.kind)
+  if n.comment.len > 0: h = h !& hashIgnoreStyle(n.comment)
+  case n.kind
+  of nkCharLit..nkUInt64Lit, nkFloatLit..nkFloat128Lit, nkStrLit..nkTripleStrLit:
+    h = h !& hashIgnoreStyle(n.strVal)
+  of nkIdent: h = h !& hashIgnoreStyle(n.ident.s)
+  of nkSym: h = h !& hashIgnoreStyle(n.sym.name.s)
+  else:
+    for x in n: h = h !& hashDef(x)
+  result = !$h
+
+proc sameDef(a, b: PNode): bool =
+  ## structural equality, style insensitive for names, literals and
+  ## comments like the comparison of the normalized rendered text was
+  if a.kind != b.kind or cmpIgnoreStyle(a.comment, b.comment) != 0:
+    return false
+  case a.kind
+  of nkCharLit..nkUInt64Lit, nkFloatLit..nkFloat128Lit, nkStrLit..nkTripleStrLit:
+    result = cmpIgnoreStyle(a.strVal, b.strVal) == 0
+  of nkIdent: result = cmpIgnoreStyle(a.ident.s, b.ident.s) == 0
+  of nkSym: result = cmpIgnoreStyle(a.sym.name.s, b.sym.name.s) == 0
+  else:
+    if a.len != b.len: return false
+    for i in 0 ..< a.len:
+      if not sameDef(a[i], b[i]): return false
+    result = true
+
+type
+  DefKey = object # a proc definition as a key for the duplicate check
+    n: PNode
+    h: Hash
+
+proc hash(k: DefKey): Hash = k.h
+proc `==`(a, b: DefKey): bool = a.h == b.h and sameDef(a.n, b.n)
 
 proc deletesNode(c: Context, n: var PNode) = 
   ## deletes nodes which match the names found in context.deletes
-  var duplicateNodeCheck: Table[string, int]
+  var duplicateNodeCheck: Table[DefKey, int]
 
   proc hasChild(n: PNode): bool = n.len() > 0
 
-  var i = 0
-  while i < n.safeLen:
+  let hasDeletes = c.deletes.len > 0
+  # the surviving children are compacted in one sweep:
+  var k = 0
+  for i in 0 ..< n.safeLen:
+    var x = n[i]
     ## handle let's / var's
-    if n[i].kind in {nkIdentDefs}:
-      if n[i].hasChild() and c.deletes.hasKey( split($(n[i][0]), "*")[0] ):
+    if x.kind in {nkIdentDefs}:
+      if hasDeletes and x.hasChild() and c.deletes.hasKey( declName(x[0]) ):
         # echo "DEL:Ident"
-        delete(n.sons, i)
         continue
 
-    if n[i].kind in {nkTypeDef, nkConstDef}:
+    if x.kind in {nkTypeDef, nkConstDef}:
       ## delete `type SomeType* = SomeType` that occurs with typedef's sometimes
-      if cmpIgnoreStyle(identName(n[i][0]), identName(n[i][2])) == 0:
-        delete(n.sons, i)
+      if sameName(x[0], x[2]):
         continue
 
-    if n[i].kind in {nkProcDef}:
+    if x.kind in {nkProcDef}:
       ## delete proc's
-      if n[i].hasChild() and c.deletes.hasKey( identName(n[i][0]) ):
+      if hasDeletes and x.hasChild() and c.deletes.hasKey( identName(x[0]) ):
         # echo "DEL:Proc"
-        delete(n.sons, i)
         continue
 
-      let def = $n[i]
-      if c.deletes.hasKey( def ):
+      if c.deletesDefs and c.deletes.hasKey( $x ):
         # echo "DEL:Proc"
-        delete(n.sons, i)
         continue
 
       ## delete duplicates
       if c.mergeDuplicates:
-        checkDuplicate(n, def)
+        let def = DefKey(n: x, h: hashDef(x))
+        if def in duplicateNodeCheck:
+          if duplicateNodeCheck[def] != x.info.line.int:
+            # echo "DEL:DUPE: ", " n.idx: ", x.info.line, " def: ", $x
+            continue
+        else:
+          duplicateNodeCheck[def] = x.info.line.int
 
     ## handle postfix -- e.g. types
-    if n[i].kind in {nkPostfix}:
-      if c.deletes.hasKey($n[i][1]):
+    if x.kind in {nkPostfix}:
+      if hasDeletes and c.deletes.hasKey(nameText(x[1])):
         # echo "DEL:PostFix"
         n = newNode(nkEmpty)
-        continue
+        return
 
     ## handle calls
-    if n[i].kind in {nkCall}:
-      if c.deletes.hasKey($n[i][0]):
+    if x.kind in {nkCall}:
+      if hasDeletes and c.deletes.hasKey(nameText(x[0])):
         # echo "DEL:Call"
-        n[i] = newNode(nkEmpty)
-        continue
+        x = newNode(nkEmpty)
     
     ## handle imports
-    if n[i].kind in {nkImportStmt}:
-      deletesNode(c, n[i])
+    if x.kind in {nkImportStmt}:
+      deletesNode(c, x)
     
     ## handle generic identifier
-    if n[i].kind in {nkIdent}:
-      if c.deletes.hasKey($n[i]):
+    if x.kind in {nkIdent}:
+      if hasDeletes and c.deletes.hasKey(nameText(x)):
         # echo "DEL:import"
-        delete(n.sons, i)
         continue
-    inc i
+    n.sons[k] = x
+    inc k
+  if k < n.safeLen: setLen(n.sons, k)
 
   n.removeBlankSections()
 
@@ -377,30 +436,39 @@ proc pp(c: var Context; n: var PNode, stmtList: PNode = nil, idx: int = -1) =
   of nkImportStmt:
     # clean up duplicate imports
     var names = initHashSet[string]()
-    var i = 0
-    while i < n.safeLen:
-      let name = $n.sons[i]
-      if name in names:
-        delete(n.sons, i)
-      else:
+    var k = 0
+    for i in 0 ..< n.safeLen:
+      let name = nameText(n.sons[i])
+      if name notin names:
         names.incl(name)
-        pp(c, n.sons[i], n, i)
-        inc i
+        n.sons[k] = n.sons[i]
+        pp(c, n.sons[k], n, k)
+        inc k
+    if k < n.safeLen: setLen(n.sons, k)
 
   of nkStmtList:
-    for i in 0 ..< n.safeLen:
-      pp(c, n.sons[i], n, i)
+    # the children are added back one by one, so that the const sections
+    # hoisted out of a child end up right in front of it:
+    var children = move(n.sons)
+    n.sons = @[]
+    for x in mitems(children):
+      pp(c, x, n, n.len)
+      n.sons.add x
 
   of nkRecList:
-    var consts: seq[int] = @[]
+    var consts: seq[PNode] = @[]
+    var k = 0
     for i in 0 ..< n.safeLen:
       pp(c, n.sons[i], stmtList, idx)
       if n.sons[i].kind == nkConstSection:
-        consts.insert(i)
-    for i in consts:
-      var cst = n.sons[i]
-      delete(n.sons, i)
-      insert(stmtList.sons, cst, idx)
+        consts.add n.sons[i]
+      else:
+        n.sons[k] = n.sons[i]
+        inc k
+    if consts.len > 0:
+      setLen(n.sons, k)
+      for j, cst in consts:
+        insert(stmtList.sons, cst, idx+j)
 
   of nkElifBranch:
     if n[1].len == 0 or isEmptyStmtList(n[1]):
@@ -415,7 +483,8 @@ proc pp(c: var Context; n: var PNode, stmtList: PNode = nil, idx: int = -1) =
     let L = n.len
     for i in 0 ..< L: pp(c, n.sons[i], stmtList, idx)
     if L > 2 and n[L-2].kind != nkEmpty and n[L-1].kind in Initializers:
-      patchBracket(c, n[L-2], n[L-1])
+      if c.deferred: c.events.add(("", n))
+      else: patchBracket(c, n[L-2], n[L-1])
 
   of nkTypeSection:
     for i in 0 ..< n.len:
@@ -426,27 +495,105 @@ proc pp(c: var Context; n: var PNode, stmtList: PNode = nil, idx: int = -1) =
   else:
     for i in 0 ..< n.safeLen: pp(c, n.sons[i], stmtList, idx)
 
-  dec depth
-
   deletesNode(c, n)
 
-proc postprocess*(n: PNode; flags: set[ParserFlag], deletes: Table[string, string]): PNode =
-  var c = Context(typedefs: initTable[string, PNode](),
-                  deletes: deletes,
-                  structStructMode: pfStructStruct in flags,
-                  reorderComments: pfReorderComments in flags,
-                  reorderTypes: pfReorderTypes in flags,
-                  mergeBlocks: pfMergeBlocks in flags,
-                  mergeDuplicates: pfMergeDuplicates in flags)
+proc replay(c: var Context; events: seq[tuple[name: string, n: PNode]]) =
+  # applies what 'pp' recorded in deferred mode, in the original order:
+  for e in events:
+    if e.name.len > 0:
+      rememberTypedef(c, e.name, e.n)
+    else:
+      let L = e.n.len
+      patchBracket(c, e.n[L-2], e.n.sons[L-1])
+
+type
+  PpJob = object # a range of top level declarations for one thread
+    c: Context
+    decls: seq[PNode]
+    results: seq[PNode] # the post processed declarations
+
+const
+  MinDeclsPerThread {.intdefine.} = 64 # fewer declarations are not worth a thread
+
+when ParallelParsing:
+  proc ppDecls(job: ptr PpJob) {.thread.} =
+    {.cast(gcsafe).}:
+      for x in mitems(job.decls):
+        var list = newNode(nkStmtList)
+        pp(job.c, x, list, 0)
+        list.add x
+        for y in list: job.results.add y
+
+proc ppParallel(c: var Context; n: var PNode; threads: int) =
+  ## Post processes the top level declarations of `n` on `threads`
+  ## threads. Only the passes over the whole list run sequentially. The
+  ## threads record typedefs and bracket patches, as these depend on the
+  ## declarations before them; they are applied afterwards in order.
+  when ParallelParsing:
+    if c.reorderComments:
+      # before the sections are merged, like the sequential path does:
+      ppComments(c, n)
+    if c.reorderTypes:
+      reorderTypes(n)
+    if c.deletes.len() > 0:
+      deletesNode(c, n)
+    if c.mergeBlocks:
+      mergeSimilarBlocks(n)
+
+    var jobs = newSeq[PpJob](threads)
+    for t in 0 ..< threads:
+      jobs[t].c = c
+      jobs[t].c.typedefs = initTable[string, PNode]()
+      jobs[t].c.deferred = true
+      for i in n.len * t div threads ..< n.len * (t+1) div threads:
+        jobs[t].decls.add n.sons[i]
+    var workers = newSeq[Thread[ptr PpJob]](threads)
+    for t in 0 ..< threads:
+      createThread(workers[t], ppDecls, addr(jobs[t]))
+    joinThreads(workers)
+
+    n.sons = @[]
+    for t in 0 ..< threads:
+      replay(c, jobs[t].c.events)
+      for x in jobs[t].results: n.add x
+    deletesNode(c, n)
+
+proc initContext*(flags: set[ParserFlag], deletes: Table[string, string]): Context =
+  result = Context(typedefs: initTable[string, PNode](),
+                   deletes: deletes,
+                   structStructMode: pfStructStruct in flags,
+                   cpp: pfCpp in flags,
+                   reorderComments: pfReorderComments in flags,
+                   reorderTypes: pfReorderTypes in flags,
+                   mergeBlocks: pfMergeBlocks in flags,
+                   mergeDuplicates: pfMergeDuplicates in flags)
+  for key in keys(deletes):
+    if key.startsWith("proc "): result.deletesDefs = true
+
+proc postprocess*(c: var Context; n: PNode; workers = 1): PNode =
+  ## post processes `n` with the typedefs `c` has seen so far. Used to
+  ## process a file statement by statement.
   result = n
 
-  ppComments(c, result)
+  let threads = min(workers, n.safeLen div MinDeclsPerThread)
+  if ParallelParsing and threads > 1 and n.kind == nkStmtList and
+      not c.structStructMode and not c.cpp:
+    ppParallel(c, result, threads)
+    return
+
+  if c.reorderComments:
+    ppComments(c, result)
 
   if c.reorderTypes:
     reorderTypes(result)
   
   pp(c, result)
 
+proc postprocess*(n: PNode; flags: set[ParserFlag], deletes: Table[string, string];
+                  workers = 1): PNode =
+  var c = initContext(flags, deletes)
+  result = postprocess(c, n, workers)
+
 proc newIdentNode(s: string; n: PNode): PNode =
   when declared(identCache):
     result = ast.newIdentNode(getIdent(identCache, s), n.info)
@@ -584,6 +584,7 @@ proc parseMangleDir(p: var Parser) =
   var pattern = parsePegLit(p)
   if p.tok.xkind != pxStrLit: expectIdent(p)
   p.options.mangleRules.add((pattern, p.tok.s))
+  invalidateMangling(p.options)
   getTok(p)
   eatNewLine(p, nil)
 
@@ -632,7 +633,7 @@ proc parseDir(p: var Parser; sectionParser: SectionParser, recur = false): PNode
      "importfuncdefines", "importdefines", "skipfuncdefines", "strict", "importc",
      "stdints", "reordercomments", "reordertypes", "mergeblocks", "mergeduplicates",
      "cppspecialization", "cppskipconverter", "cppskipcallop", "nomultimangle",
-     "cppbindstatic", "anonymousasfields", "clibuserpragma":
+     "cppbindstatic", "anonymousasfields", "clibuserpragma", "typetable":
     discard setOption(p.options, p.tok.s)
     getTok(p)
     eatNewLine(p, nil)
@@ -657,7 +658,8 @@ proc parseDir(p: var Parser; sectionParser: SectionParser, recur = false): PNode
     eatNewLine(p, nil)
     result = emptyNode
   of "dynlib", "prefix", "suffix", "class", "discardableprefix",
-      "assumedef", "assumendef", "isarray", "delete", "headerprefix":
+      "assumedef", "assumendef", "isarray", "delete", "headerprefix",
+      "knowntype":
     var key = p.tok.s
     getTok(p)
     if p.tok.xkind != pxStrLit: expectIdent(p)
@@ -691,6 +693,7 @@ proc parseDir(p: var Parser; sectionParser: SectionParser, recur = false): PNode
   of "private":
     var pattern = parsePegLit(p)
     p.options.privateRules.add(pattern)
+    invalidateMangling(p.options)
     eatNewLine(p, nil)
   else:
     # ignore unimportant/unknown directive ("undef", "pragma", "error")
@@ -0,0 +1,111 @@
+#
+#
+#      c2nim - C to Nim source converter
+#        (c) Copyright 2015 Andreas Rumpf
+#
+#    See the file "copying.txt", included in this
+#    distribution, for details about the copyright.
+#
+
+# The backtracking profiler for ``--profile:backtrack``: Every
+# 'saveContext' and 'saveContextB' is an attempt of the parser rule that
+# calls it. The profiler counts the attempts, the backtracks and the tokens
+# that are read again per call site in the parser and per line of the C
+# input. This file is included by cparser.nim.
+
+type
+  BacktrackCounts* = object
+    attempts*, backtracks*, reread*: int
+
+  BacktrackSite = tuple[file: string, line: int] # a call site in the parser
+
+  BacktrackProfile* = ref object
+    rules*: Table[BacktrackSite, BacktrackCounts]
+    inputs*: Table[string, BacktrackCounts] # by "file(line)" of the C input
+    sites, sitesB: seq[tuple[rule: BacktrackSite, input: string]]
+
+proc ruleTable(src: string): seq[tuple[line: int, name: string]] {.compileTime.} =
+  # the lines of the top level procs:
+  result = @[]
+  var line = 0
+  for x in splitLines(src):
+    inc line
+    if x.startsWith("proc "):
+      var i = 5
+      while i < x.len and x[i] in IdentChars: inc i
+      result.add((line, x.substr(5, i-1)))
+
+const
+  parserRules = ruleTable(staticRead("cparser.nim"))
+  preprocessorRules = ruleTable(staticRead("preprocessor.nim"))
+
+proc ruleName(site: BacktrackSite): string =
+  result = "?"
+  for r in (if site.file == "preprocessor.nim": preprocessorRules
+            else: parserRules):
+    if r.line > site.line: break
+    result = r.name
+  result = result & " " & site.file & "(" & $site.line & ")"
+
+var
+  gBacktrackProfile*: BacktrackProfile ## of all closed parsers
+
+proc add(a: var BacktrackCounts; b: BacktrackCounts) =
+  inc a.attempts, b.attempts
+  inc a.backtracks, b.backtracks
+  inc a.reread, b.reread
+
+proc mergeProfile(p: BacktrackProfile) =
+  if gBacktrackProfile.isNil: gBacktrackProfile = BacktrackProfile()
+  for k, v in p.rules:
+    add(mgetOrPut(gBacktrackProfile.rules, k, BacktrackCounts()), v)
+  for k, v in p.inputs:
+    add(mgetOrPut(gBacktrackProfile.inputs, k, BacktrackCounts()), v)
+
+proc attempt(p: BacktrackProfile; sites: var seq[tuple[rule: BacktrackSite,
+             input: string]]; rule: BacktrackSite; input: string) =
+  sites.add((rule, input))
+  inc mgetOrPut(p.rules, rule, BacktrackCounts()).attempts
+  inc mgetOrPut(p.inputs, input, BacktrackCounts()).attempts
+
+proc backtracked(p: BacktrackProfile; sites: var seq[tuple[rule: BacktrackSite,
+                 input: string]]; reread: int) =
+  let s = sites.pop()
+  add(mgetOrPut(p.rules, s.rule, BacktrackCounts()),
+      BacktrackCounts(backtracks: 1, reread: reread))
+  add(mgetOrPut(p.inputs, s.input, BacktrackCounts()),
+      BacktrackCounts(backtracks: 1, reread: reread))
+
+proc distance(a, b: ref Token): int =
+  # the number of tokens from `a` to `b`:
+  result = 0
+  var t = a
+  while t != nil and t != b:
+    inc result
+    t = t.next
+
+proc writeTop[K](f: File; title: string; t: Table[K, BacktrackCounts];
+                 top: int; nameOf: proc (k: K): string {.nimcall.}) =
+  var entries: seq[(string, BacktrackCounts)] = @[]
+  for k, v in t: entries.add((nameOf(k), v))
+  entries.sort(proc (a, b: (string, BacktrackCounts)): int =
+    result = cmp(b[1].reread, a[1].reread)
+    if result == 0: result = cmp(b[1].attempts, a[1].attempts))
+  f.writeLine title
+  f.writeLine "  attempts backtracks    reread"
+  for i in 0 ..< min(top, entries.len):
+    let c = entries[i][1]
+    f.writeLine "  ", align($c.attempts, 8), " ", align($c.backtracks, 10),
+                " ", align($c.reread, 9), "  ", entries[i][0]
+
+proc inputName(s: string): string = s
+
+proc writeBacktrackProfile*(f: File; top = 20) =
+  ## writes the `top` parser rules and input lines that reread the most
+  ## tokens.
+  let prof = gBacktrackProfile
+  if prof.isNil:
+    f.writeLine "no backtracking"
+    return
+  writeTop(f, "backtracking by parser rule:", prof.rules, top, ruleName)
+  writeTop(f, "backtracking by input line:", prof.inputs, top, inputName)
@@ -0,0 +1,11 @@
+#typetable
+
+template <typename T> struct Box { T value; };
+
+template <typename T> T scale(T a, int b) {
+  T * p;
+  Box<T> q;
+  a * b;
+  a < b;
+  return a;
+}
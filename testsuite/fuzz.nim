@@ -0,0 +1,250 @@
+# Small program that mutates the test files and looks for inputs on which
+# c2nim hangs, crashes or needs too much memory
+
+import strutils, os, osproc, parseopt, random, sets, hashes, algorithm, times
+
+import ../compiler/ [llstream, ast]
+import ../clexer, ../cparser, ../postprocessor
+
+const
+  dir = "testsuite/"
+  fuzzDir = dir & "fuzz/"
+  nullDevice = when defined(windows): "NUL" else: "/dev/null"
+  usage = """
+c2nim fuzzer
+Usage: fuzz [options]
+  Mutates the test files and translates every mutation in a child process.
+  Mutations that produce new features (node kinds, amounts of tokens and
+  backtracking) are kept for further mutation. A mutation that exceeds the
+  time or memory budget or that crashes c2nim is minimized and saved in
+  testsuite/fuzz/.
+Options:
+  -h --help          Shows this help
+  --cpp              Fuzz the C++ parser
+  --iterations:N     Number of mutations to try (default: 1000)
+  --timeout:MS       Time budget per input in milliseconds (default: 2000)
+  --maxmem:MB        Memory budget per input in megabytes (default: 512)
+  --seed:N           Seed of the random mutations (default: 0)
+  --minimize:N       Maximal number of attempts to shrink an input
+                     (default: 200)
+  --check            Translate the inputs in testsuite/fuzz/ and fail if one
+                     of them still exceeds its budget or crashes
+"""
+
+type
+  Outcome = enum
+    ok, hang, blowup, crash
+
+var
+  exitEarly = false
+  one = ""
+  report = ""
+  cpp = false
+  iterations = 1000
+  timeout = 2000
+  maxmem = 512
+  seed = 0
+  minimizeSteps = 200
+  check = false
+
+for kind, key, val in getopt():
+  case kind
+  of cmdArgument:
+    one = key
+  of cmdLongOption, cmdShortOption:
+    case key.normalize
+    of "help", "h":
+      stdout.write(usage)
+      exitEarly = true
+    of "cpp": cpp = true
+    of "iterations": iterations = parseInt(val)
+    of "timeout": timeout = parseInt(val)
+    of "maxmem": maxmem = parseInt(val)
+    of "seed": seed = parseInt(val)
+    of "minimize": minimizeSteps = parseInt(val)
+    of "check": check = true
+    of "report": report = val
+    else:
+      stdout.writeLine("[Error] unknown option: " & key)
+  else: discard
+
+proc fuzzOne(input: string; cpp: bool): PNode =
+  ## parses and post processes `input` like c2nim does with a file.
+  var options = newParserOptions()
+  if cpp: options.flags.incl pfCpp
+  var p: Parser
+  openParser(p, "fuzz.h", llStreamOpen(input), options)
+  result = parseUnit(p)
+  closeParser(p)
+  result = postprocess(result, options.flags, options.deletes)
+
+proc features(n: PNode; result: var HashSet[string]) =
+  result.incl $n.kind
+  for i in 0 ..< n.safeLen: features(n[i], result)
+
+proc bucket(x: int): int =
+  # the number of bits of `x`:
+  var x = x
+  while x > 0:
+    x = x shr 1
+    inc result
+
+proc runChild() =
+  # translates the file `one` and writes the features to `report`. The
+  # exit code 3 means that the memory budget was exceeded, 4 that c2nim
+  # crashed:
+  discard reopen(stdout, nullDevice, fmWrite)
+  discard reopen(stderr, nullDevice, fmWrite)
+  var f = initHashSet[string]()
+  try:
+    features(fuzzOne(readFile(one), cpp), f)
+  except CatchableError:
+    f.incl "error"
+  except Defect:
+    quit(4)
+  f.incl "tokens" & $bucket(gTokensLexed)
+  f.incl "backtracks" & $bucket(gBacktracks)
+  var s: seq[string] = @[]
+  for x in f: s.add x
+  writeFile(report, s.join(" "))
+  if getMaxMem() > maxmem * 1024 * 1024: quit(3)
+
+# per session, so that several fuzzers can run at the same time:
+let tmpName = getTempDir() / "c2nim_fuzz_" & $getCurrentProcessId() &
+              (if cpp: "_cpp" else: "")
+let tmpInput = tmpName & (if cpp: ".hpp" else: ".h")
+let tmpReport = tmpName & ".txt"
+
+proc residentMem(pid: int): int =
+  # the memory of a running process in bytes; 0 if /proc does not tell:
+  result = 0
+  try:
+    for line in lines("/proc/" & $pid & "/status"):
+      if line.startsWith("VmRSS:"):
+        result = parseInt(line.substr(6).strip.split(' ')[0]) * 1024
+  except IOError, OSError, ValueError:
+    discard
+
+proc run(input: string; feats: var seq[string]): Outcome =
+  writeFile(tmpInput, input)
+  removeFile(tmpReport)
+  var args = @["--maxmem:" & $maxmem, "--report:" & tmpReport, tmpInput]
+  if cpp: args.insert("--cpp", 0)
+  var p = startProcess(getAppFilename(), args = args, options = {})
+  # the budgets are enforced while the child runs; the child checks its
+  # peak memory itself where there is no /proc:
+  let start = epochTime()
+  result = ok
+  while running(p):
+    if (epochTime() - start) * 1000.0 > timeout.float: result = hang
+    elif residentMem(processID(p)) > maxmem * 1024 * 1024: result = blowup
+    else:
+      sleep(5)
+      continue
+    terminate(p)
+    break
+  let exitCode = waitForExit(p)
+  if result == ok:
+    case exitCode
+    of 0, 1: discard # 1: c2nim quits on a syntax error
+    of 3: result = blowup
+    else: result = crash
+  close(p)
+  # c2nim quits on a syntax error without a report:
+  feats = if fileExists(tmpReport): readFile(tmpReport).split(' ')
+          else: @["quit"]
+
+proc run(input: string): Outcome =
+  var ignored: seq[string]
+  result = run(input, ignored)
+
+proc minimize(input: string; outcome: Outcome): string =
+  # removes ever smaller chunks of `input` as long as it still exceeds its
+  # budget in the same way:
+  result = input
+  var chunk = result.len div 2
+  var steps = 0
+  while chunk > 0 and steps < minimizeSteps:
+    var i = 0
+    while i < result.len and steps < minimizeSteps:
+      let candidate = result[0 ..< i] & result[min(i + chunk, result.len) .. ^1]
+      inc steps
+      if run(candidate) == outcome: result = candidate
+      else: inc i, chunk
+    chunk = chunk div 2
+
+const snippets = ["<", ">", "(", ")", "((int)", "{", "}", ";", "*", "::",
+                  "template <typename T> ", "#define F(x) F(x)\n",
+                  "#ifdef X\n", "#endif\n", "typedef ", "struct ", ","]
+
+proc mutate(r: var Rand; corpus: seq[string]): string =
+  result = corpus[r.rand(corpus.high)]
+  if result.len == 0: return snippets[r.rand(snippets.high)]
+  let a = r.rand(result.high)
+  let b = min(result.len, a + r.rand(1 .. 64))
+  case r.rand(4)
+  of 0: result = result[0 ..< a] & result[b .. ^1]
+  of 1: result = result[0 ..< b] & result[a ..< b] & result[b .. ^1]
+  of 2: result.insert(snippets[r.rand(snippets.high)], a)
+  of 3:
+    let other = corpus[r.rand(corpus.high)]
+    result = result[0 ..< a] & other[min(r.rand(other.len), other.len) .. ^1]
+  else:
+    # repeats a range; the nesting blows up:
+    result = result[0 ..< a] & repeat(result[a ..< b], r.rand(2 .. 32)) &
+             result[b .. ^1]
+
+proc save(input: string; outcome: Outcome) =
+  createDir(fuzzDir)
+  let name = fuzzDir & $outcome & "_" & toHex(hash(input) and 0xFFFFFFFF, 8) &
+             (if cpp: ".hpp" else: ".h")
+  writeFile(name, input)
+  echo "SAVED: ", name
+
+proc fuzz() =
+  var r = initRand(seed)
+  var corpus: seq[string] = @[]
+  # the saved inputs in fuzz/ exceed their budget and are left to --check;
+  # as seeds they would cost the full timeout and be found again:
+  for pattern in (if cpp: @["tests/*.cpp", "tests/*.hpp"]
+                  else: @["tests/*.c", "tests/*.h"]):
+    for t in walkFiles(dir & pattern): corpus.add readFile(t)
+  if corpus.len == 0: quit("[Error] no input files")
+  var seen = initHashSet[string]()
+  var f: seq[string]
+  for x in corpus:
+    discard run(x, f)
+    for y in f: seen.incl y
+  var found = 0
+  for i in 1..iterations:
+    let input = mutate(r, corpus)
+    let outcome = run(input, f)
+    if outcome != ok:
+      echo "FOUND: ", outcome, " after ", i, " mutations"
+      save(minimize(input, outcome), outcome)
+      inc found
+    else:
+      var isNew = false
+      for y in f:
+        if not seen.containsOrIncl(y): isNew = true
+      if isNew: corpus.add input
+  echo "corpus: ", corpus.len, " inputs, found: ", found
+
+proc checkSaved() =
+  var failures = 0
+  var files: seq[string] = @[]
+  for t in walkFiles(fuzzDir & (if cpp: "*.hpp" else: "*.h")): files.add t
+  sort(files)
+  for t in files:
+    let outcome = run(readFile(t))
+    if outcome != ok:
+      echo "FAILURE: ", outcome, ": ", t
+      inc failures
+    else:
+      echo "SUCCESS: within the budget: ", t
+  if failures > 0: quit($failures & " inputs exceed their budget.")
+
+if not exitEarly:
+  if one.len > 0: runChild()
+  elif check: checkSaved()
+  else: fuzz()
@@ -0,0 +1,45 @@
+/* parsed in regions by the parallel build of the tester */
+
+#define LIMIT_SMALL 1'000
+#define LIMIT_LARGE 100'000
+
+int parse_int(const char *s, int base);
+int parse_float(const char *s, double *value);
+int parse_char(const char *s, char quote);
+
+/* a quote after a digit separates digits and does not start a literal */
+
+#define SEPARATED_A 1'2'3
+#define SEPARATED_B 4'5'6
+#define SEPARATED_C 7'8'9
+#define SEPARATED_D 10'000
+#define SEPARATED_E 20'000
+#define SEPARATED_F 30'000
+#define SEPARATED_G 40'000
+#define SEPARATED_H 50'000
+#define CHAR_BRACE '{'
+
+int scan_block(const char *s, int depth);
+int scan_line(const char *s, int line);
+int scan_limit(int limit);
+int scan_count(int count);
+
+/* consecutive defines end up in one const section */
+
+#define COUNT_A 1
+#define COUNT_B 2
+#define COUNT_C 3
+#define COUNT_D 4
+#define COUNT_E 5
+#define COUNT_F 6
+#define COUNT_G 7
+#define COUNT_H 8
+#define COUNT_I 9
+#define COUNT_J 10
+#define COUNT_K 11
+#define COUNT_L 12
+
+int count_a(int n);
+int count_b(int n);
+int count_c(int n);
+int count_d(int n);
@@ -0,0 +1,192 @@
+# Small program that compares c2nim's performance with a stored baseline
+
+import strutils, os, osproc, parseopt, strscans, times, tables, hashes,
+  algorithm
+
+include testcommands
+
+const
+  c2nimCmd = command("c2nim --stats", c2nimOpts)
+  cpp2nimCmd = command("c2nim --stats", cpp2nimOpts)
+  cpp2nimCmdKeepBodies = command("c2nim --stats", cpp2nimKeepBodiesOpts)
+  hpp2nimCmd = command("c2nim --stats", hpp2nimOpts)
+  c2nimExtrasCmd = command("c2nim --stats", c2nimExtrasOpts)
+  dir = "testsuite/"
+  baselineFile = dir & "perfbaseline.txt"
+  usage = """
+c2nim performance gate
+Usage: perfgate testnames [options]
+  Translates the test files and compares the tokens, the backtracking steps,
+  the peak memory and the time of every test with the baseline in
+  testsuite/perfbaseline.txt. The time is measured in units of a calibration
+  loop, so that baselines from different machines are comparable. A test
+  without a baseline fails; record it with --overwrite. As long as the
+  baseline has no entries at all, the gate is skipped.
+Options:
+  -h --help        Shows this help
+  --overwrite      Overwrite the baseline with the current results
+  --margin:P       Allowed growth in percent of tokens, backtracking steps
+                   and memory (default: 10)
+  --timeMargin:P   Allowed growth in percent of the time (default: 50)
+  --runs:N         Translate every file N times and keep the fastest run
+                   (default: 3)
+"""
+
+type
+  Metrics = object
+    tokens, backtracks, maxmem: int
+    time: float # in units of the calibration loop
+
+var
+  failures = 0
+  exitEarly = false
+  infiles = newSeq[string](0)
+  overwrite = false
+  margin = 10.0
+  timeMargin = 50.0
+  runs = 3
+
+for kind, key, val in getopt():
+  case kind
+  of cmdArgument:
+    infiles.add key
+  of cmdLongOption, cmdShortOption:
+    case key.normalize
+    of "help", "h":
+      stdout.write(usage)
+      exitEarly = true
+    of "overwrite":
+      overwrite = true
+    of "margin":
+      margin = parseFloat(val)
+    of "timemargin":
+      timeMargin = parseFloat(val)
+    of "runs":
+      runs = max(parseInt(val), 1)
+  else:
+    stdout.writeLine("[Error] unknown option: " & key)
+
+proc exec(cmd: string) =
+  if execShellCmd(cmd) != 0: quit("FAILURE: " & cmd)
+
+proc calibrate(): float =
+  # the time of a fixed amount of hashing and string work; the fastest of a
+  # few runs:
+  result = Inf
+  for r in 1..3:
+    let start = epochTime()
+    var h: Hash = 0
+    var s = ""
+    for i in 1..2_000_000:
+      s.add chr(ord('a') + i mod 26)
+      if s.len > 64: s.setLen 0
+      h = h !& hash(s)
+    doAssert h != 1 # keep the loop
+    result = min(result, epochTime() - start)
+
+proc readBaseline(): Table[string, Metrics] =
+  result = initTable[string, Metrics]()
+  if not fileExists(baselineFile): return
+  for line in lines(baselineFile):
+    var name, time: string
+    var m: Metrics
+    if scanf(line, "$w $i $i $i $+", name, m.tokens, m.backtracks,
+             m.maxmem, time):
+      m.time = parseFloat(time)
+      result[name] = m
+
+proc writeBaseline(t: Table[string, Metrics]) =
+  # sorted by name, so that a new baseline diffs well:
+  var names: seq[string] = @[]
+  for name in keys(t): names.add name
+  sort(names)
+  var f = open(baselineFile, fmWrite)
+  f.writeLine "# test tokens backtracks maxmem time; see perfgate.nim"
+  for name in names:
+    let m = t[name]
+    f.writeLine name, " ", m.tokens, " ", m.backtracks, " ", m.maxmem, " ",
+                formatFloat(m.time, ffDecimal, 3)
+  f.close
+
+var
+  unit = 1.0
+  baseline = initTable[string, Metrics]()
+  current = initTable[string, Metrics]()
+
+proc exceeds(name: string; now, before: float; margin: float;
+             slack = 0.0): bool =
+  result = now > before * (1.0 + margin / 100.0) + slack
+  if result:
+    echo "FAILURE: ", name, " grew from ", formatFloat(before, ffDecimal, 3),
+         " to ", formatFloat(now, ffDecimal, 3)
+
+proc test(t, cmd: string) =
+  let (_, name, _) = splitFile(t)
+  if infiles.len() > 0 and not (name in infiles):
+    return
+  echo "TEST: ", name
+  var m = Metrics(time: Inf)
+  for r in 1..runs:
+    let (output, exitCode) = execCmdEx(cmd % t)
+    if exitCode != 0: quit("FAILURE: " & cmd % t)
+    var lineCount, tokens, backtracks, maxmem: int
+    var time: float
+    var found = false
+    for line in splitLines(output):
+      if scanf(line, "stats: lines=$i tokens=$i backtracks=$i maxmem=$i time=$f",
+               lineCount, tokens, backtracks, maxmem, time):
+        m.tokens = tokens
+        m.backtracks = backtracks
+        m.maxmem = maxmem
+        m.time = min(m.time, time / unit)
+        found = true
+    if not found:
+      echo "FAILURE: no stats line: ", cmd % t
+      inc failures
+      return
+  current[name] = m
+  if name notin baseline:
+    if overwrite:
+      echo "NEW: no baseline for ", name
+    else:
+      echo "FAILURE: no baseline for ", name
+      inc failures
+  else:
+    let b = baseline[name]
+    var failed = false
+    failed = exceeds(name & " tokens", m.tokens.float, b.tokens.float, margin) or failed
+    failed = exceeds(name & " backtracks", m.backtracks.float, b.backtracks.float, margin) or failed
+    failed = exceeds(name & " maxmem", m.maxmem.float, b.maxmem.float, margin) or failed
+    # the small tests take a fraction of the calibration loop; their times
+    # are mostly noise:
+    failed = exceeds(name & " time", m.time, b.time, timeMargin, 0.1) or failed
+    if failed: inc failures
+    else: echo "SUCCESS: within the baseline: ", name
+
+if not exitEarly:
+  baseline = readBaseline()
+  if baseline.len == 0 and not overwrite:
+    # nothing to compare with before the first baseline is recorded:
+    echo "SKIPPED: no baseline in ", baselineFile, "; record it with --overwrite"
+    quit(0)
+  exec("nim c -d:release c2nim.nim")
+  unit = calibrate()
+  for t in walkFiles(dir & "tests/*.c"):
+    test(t, c2nimCmd)
+  for t in walkFiles(dir & "tests/*.h"):
+    test(t, c2nimCmd)
+  for t in walkFiles(dir & "tests/*.cpp"):
+    test(t, cpp2nimCmd)
+  for t in walkFiles(dir & "tests/*.hpp"):
+    test(t, hpp2nimCmd)
+
+  for t in walkFiles(dir & "cppkeepbodies/*.cpp"):
+    test(t, cpp2nimCmdKeepBodies)
+  for t in walkFiles(dir & "cextras/*.h"):
+    test(t, c2nimExtrasCmd)
+
+  if overwrite:
+    # keep the entries of the tests that did not run:
+    for name, m in current: baseline[name] = m
+    writeBaseline(baseline)
+  if failures > 0: quit($failures & " tests exceed their baseline.")
@@ -26,3 +26,21 @@ const
   negativeten = nten
   aliasA* = one
   aliasB* = nnine
+
+type
+  flags* = enum
+    f_low = 1, f_next, f_high = 4 shl UNKNOWN_SHIFT
+
+
+type
+  wide* = enum
+    w_min = -(-9223372036854775807 - 1), w_low = -1,
+    w_wrap = (1 shl 40) * (1 shl 40) + 1
+
+
+type
+  implicit* = enum
+    i_zero, i_one, i_two = i_zero + 2
+
+const
+  i_lit_two = i_two
@@ -0,0 +1,11 @@
+const
+  FLAGS_NONE* = 0
+
+type
+  flags* {.bycopy.} = object
+    value*: cint
+    mask*: cint
+
+
+proc flags_set*(f: ptr flags; bit: cint): cint
+proc flags_test*(f: ptr flags; `type`: cint): cint
\ No newline at end of file
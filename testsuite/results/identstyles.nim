@@ -0,0 +1,4 @@
+proc fooBar*(x: cint): cint
+proc foo_bar*(x: cint): cint
+proc FooBar*(x: cint): cint
+proc foobar*(x: cint): cint
\ No newline at end of file
@@ -0,0 +1,4 @@
+proc close_all*(list: ptr Handle; n: cint): cint =
+  var it: ptr Handle
+  list * n
+  return n
\ No newline at end of file
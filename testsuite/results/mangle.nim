@@ -0,0 +1,7 @@
+proc openV2*(name: cstring): cint
+proc GLClear*(mask: cint): cint
+proc closeV3*(fd: cint): cint
+proc GLFlush*(): cint
+proc other*(x: cint): cint
+proc v4_read*(fd: cint): cint
+proc glFinish*(): cint
\ No newline at end of file
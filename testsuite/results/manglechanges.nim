@@ -0,0 +1,7 @@
+proc open*(fd: cint): cint
+proc io_open*(fd: cint): cint
+proc hidden_count*(): cint
+proc open*(fd: cint): cint
+proc openIo*(fd: cint): cint
+proc read*(fd: cint): cint
+proc hidden_count(): cint
\ No newline at end of file
@@ -0,0 +1,3 @@
+proc get_value*(the_x: cint): cint
+proc get_value*(the_x: clong): cint
+proc set_value*(x: cint): cint
\ No newline at end of file
@@ -0,0 +1,46 @@
+##  parsed in regions by the parallel build of the tester
+
+const
+  LIMIT_SMALL* = 1000
+  LIMIT_LARGE* = 100000
+
+proc parse_int*(s: cstring; base: cint): cint
+proc parse_float*(s: cstring; value: ptr cdouble): cint
+proc parse_char*(s: cstring; quote: char): cint
+##  a quote after a digit separates digits and does not start a literal
+
+const
+  SEPARATED_A* = 123
+  SEPARATED_B* = 456
+  SEPARATED_C* = 789
+  SEPARATED_D* = 10000
+  SEPARATED_E* = 20000
+  SEPARATED_F* = 30000
+  SEPARATED_G* = 40000
+  SEPARATED_H* = 50000
+  CHAR_BRACE* = '{'
+
+proc scan_block*(s: cstring; depth: cint): cint
+proc scan_line*(s: cstring; line: cint): cint
+proc scan_limit*(limit: cint): cint
+proc scan_count*(count: cint): cint
+##  consecutive defines end up in one const section
+
+const
+  COUNT_A* = 1
+  COUNT_B* = 2
+  COUNT_C* = 3
+  COUNT_D* = 4
+  COUNT_E* = 5
+  COUNT_F* = 6
+  COUNT_G* = 7
+  COUNT_H* = 8
+  COUNT_I* = 9
+  COUNT_J* = 10
+  COUNT_K* = 11
+  COUNT_L* = 12
+
+proc count_a*(n: cint): cint
+proc count_b*(n: cint): cint
+proc count_c*(n: cint): cint
+proc count_d*(n: cint): cint
\ No newline at end of file
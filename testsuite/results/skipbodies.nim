@@ -0,0 +1,8 @@
+type
+  Counter* {.bycopy.} = object
+
+
+proc limit*(this: Counter): cint {.noSideEffect.}
+proc brace*(this: Counter): char {.noSideEffect.}
+proc size*(this: Counter): cint {.noSideEffect.}
+proc counter_max*(): cint
\ No newline at end of file
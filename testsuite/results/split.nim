@@ -0,0 +1,17 @@
+import
+  split_part1
+
+import
+  split_part2
+
+import
+  split_part3
+
+export
+  split_part1
+
+export
+  split_part2
+
+export
+  split_part3
@@ -0,0 +1,49 @@
+const
+  SPLIT_FIRST_VALUE_00* = 100
+  SPLIT_FIRST_VALUE_01* = 101
+  SPLIT_FIRST_VALUE_02* = 102
+  SPLIT_FIRST_VALUE_03* = 103
+  SPLIT_FIRST_VALUE_04* = 104
+  SPLIT_FIRST_VALUE_05* = 105
+  SPLIT_FIRST_VALUE_06* = 106
+  SPLIT_FIRST_VALUE_07* = 107
+  SPLIT_FIRST_VALUE_08* = 108
+  SPLIT_FIRST_VALUE_09* = 109
+  SPLIT_FIRST_VALUE_10* = 110
+  SPLIT_FIRST_VALUE_11* = 111
+  SPLIT_FIRST_VALUE_12* = 112
+  SPLIT_FIRST_VALUE_13* = 113
+  SPLIT_FIRST_VALUE_14* = 114
+  SPLIT_FIRST_VALUE_15* = 115
+  SPLIT_FIRST_VALUE_16* = 116
+  SPLIT_FIRST_VALUE_17* = 117
+  SPLIT_FIRST_VALUE_18* = 118
+  SPLIT_FIRST_VALUE_19* = 119
+  SPLIT_FIRST_VALUE_20* = 120
+  SPLIT_FIRST_VALUE_21* = 121
+  SPLIT_FIRST_VALUE_22* = 122
+  SPLIT_FIRST_VALUE_23* = 123
+  SPLIT_FIRST_VALUE_24* = 124
+  SPLIT_FIRST_VALUE_25* = 125
+  SPLIT_FIRST_VALUE_26* = 126
+  SPLIT_FIRST_VALUE_27* = 127
+  SPLIT_FIRST_VALUE_28* = 128
+  SPLIT_FIRST_VALUE_29* = 129
+  SPLIT_FIRST_VALUE_30* = 130
+  SPLIT_FIRST_VALUE_31* = 131
+  SPLIT_FIRST_VALUE_32* = 132
+  SPLIT_FIRST_VALUE_33* = 133
+  SPLIT_FIRST_VALUE_34* = 134
+  SPLIT_FIRST_VALUE_35* = 135
+  SPLIT_FIRST_VALUE_36* = 136
+  SPLIT_FIRST_VALUE_37* = 137
+  SPLIT_FIRST_VALUE_38* = 138
+  SPLIT_FIRST_VALUE_39* = 139
+  SPLIT_FIRST_VALUE_40* = 140
+  SPLIT_FIRST_VALUE_41* = 141
+  SPLIT_FIRST_VALUE_42* = 142
+  SPLIT_FIRST_VALUE_43* = 143
+  SPLIT_FIRST_VALUE_44* = 144
+  SPLIT_FIRST_VALUE_45* = 145
+  SPLIT_FIRST_VALUE_46* = 146
+  SPLIT_FIRST_VALUE_47* = 147
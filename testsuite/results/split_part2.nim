@@ -0,0 +1,56 @@
+import
+  split_part1
+
+export
+  split_part1
+
+proc split_first*(x: cint): cint
+const
+  SPLIT_SECOND_VALUE_00* = 200
+  SPLIT_SECOND_VALUE_01* = 201
+  SPLIT_SECOND_VALUE_02* = 202
+  SPLIT_SECOND_VALUE_03* = 203
+  SPLIT_SECOND_VALUE_04* = 204
+  SPLIT_SECOND_VALUE_05* = 205
+  SPLIT_SECOND_VALUE_06* = 206
+  SPLIT_SECOND_VALUE_07* = 207
+  SPLIT_SECOND_VALUE_08* = 208
+  SPLIT_SECOND_VALUE_09* = 209
+  SPLIT_SECOND_VALUE_10* = 210
+  SPLIT_SECOND_VALUE_11* = 211
+  SPLIT_SECOND_VALUE_12* = 212
+  SPLIT_SECOND_VALUE_13* = 213
+  SPLIT_SECOND_VALUE_14* = 214
+  SPLIT_SECOND_VALUE_15* = 215
+  SPLIT_SECOND_VALUE_16* = 216
+  SPLIT_SECOND_VALUE_17* = 217
+  SPLIT_SECOND_VALUE_18* = 218
+  SPLIT_SECOND_VALUE_19* = 219
+  SPLIT_SECOND_VALUE_20* = 220
+  SPLIT_SECOND_VALUE_21* = 221
+  SPLIT_SECOND_VALUE_22* = 222
+  SPLIT_SECOND_VALUE_23* = 223
+  SPLIT_SECOND_VALUE_24* = 224
+  SPLIT_SECOND_VALUE_25* = 225
+  SPLIT_SECOND_VALUE_26* = 226
+  SPLIT_SECOND_VALUE_27* = 227
+  SPLIT_SECOND_VALUE_28* = 228
+  SPLIT_SECOND_VALUE_29* = 229
+  SPLIT_SECOND_VALUE_30* = 230
+  SPLIT_SECOND_VALUE_31* = 231
+  SPLIT_SECOND_VALUE_32* = 232
+  SPLIT_SECOND_VALUE_33* = 233
+  SPLIT_SECOND_VALUE_34* = 234
+  SPLIT_SECOND_VALUE_35* = 235
+  SPLIT_SECOND_VALUE_36* = 236
+  SPLIT_SECOND_VALUE_37* = 237
+  SPLIT_SECOND_VALUE_38* = 238
+  SPLIT_SECOND_VALUE_39* = 239
+  SPLIT_SECOND_VALUE_40* = 240
+  SPLIT_SECOND_VALUE_41* = 241
+  SPLIT_SECOND_VALUE_42* = 242
+  SPLIT_SECOND_VALUE_43* = 243
+  SPLIT_SECOND_VALUE_44* = 244
+  SPLIT_SECOND_VALUE_45* = 245
+  SPLIT_SECOND_VALUE_46* = 246
+  SPLIT_SECOND_VALUE_47* = 247
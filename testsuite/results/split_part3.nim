@@ -0,0 +1,7 @@
+import
+  split_part2
+
+export
+  split_part2
+
+proc split_second*(x: cint): cint
\ No newline at end of file
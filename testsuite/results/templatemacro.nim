@@ -0,0 +1,4 @@
+proc make_ints*(n: cint): vector[cint]
+proc nested_ints*(n: cint): vector[vector[cint]]
+proc mixed*(n: cint): map[cint, vector[cfloat]]
+proc plain*(n: cint): vector[vector[cint]]
\ No newline at end of file
@@ -0,0 +1,11 @@
+type
+  Box*[T] {.bycopy.} = object
+    value*: T
+
+
+proc scale*[T](a: T; b: cint): T =
+  var p: ptr T
+  var q: Box[T]
+  a * b
+  a < b
+  return a
\ No newline at end of file
@@ -0,0 +1,101 @@
+#define SPLIT_FIRST_VALUE_00 100
+#define SPLIT_FIRST_VALUE_01 101
+#define SPLIT_FIRST_VALUE_02 102
+#define SPLIT_FIRST_VALUE_03 103
+#define SPLIT_FIRST_VALUE_04 104
+#define SPLIT_FIRST_VALUE_05 105
+#define SPLIT_FIRST_VALUE_06 106
+#define SPLIT_FIRST_VALUE_07 107
+#define SPLIT_FIRST_VALUE_08 108
+#define SPLIT_FIRST_VALUE_09 109
+#define SPLIT_FIRST_VALUE_10 110
+#define SPLIT_FIRST_VALUE_11 111
+#define SPLIT_FIRST_VALUE_12 112
+#define SPLIT_FIRST_VALUE_13 113
+#define SPLIT_FIRST_VALUE_14 114
+#define SPLIT_FIRST_VALUE_15 115
+#define SPLIT_FIRST_VALUE_16 116
+#define SPLIT_FIRST_VALUE_17 117
+#define SPLIT_FIRST_VALUE_18 118
+#define SPLIT_FIRST_VALUE_19 119
+#define SPLIT_FIRST_VALUE_20 120
+#define SPLIT_FIRST_VALUE_21 121
+#define SPLIT_FIRST_VALUE_22 122
+#define SPLIT_FIRST_VALUE_23 123
+#define SPLIT_FIRST_VALUE_24 124
+#define SPLIT_FIRST_VALUE_25 125
+#define SPLIT_FIRST_VALUE_26 126
+#define SPLIT_FIRST_VALUE_27 127
+#define SPLIT_FIRST_VALUE_28 128
+#define SPLIT_FIRST_VALUE_29 129
+#define SPLIT_FIRST_VALUE_30 130
+#define SPLIT_FIRST_VALUE_31 131
+#define SPLIT_FIRST_VALUE_32 132
+#define SPLIT_FIRST_VALUE_33 133
+#define SPLIT_FIRST_VALUE_34 134
+#define SPLIT_FIRST_VALUE_35 135
+#define SPLIT_FIRST_VALUE_36 136
+#define SPLIT_FIRST_VALUE_37 137
+#define SPLIT_FIRST_VALUE_38 138
+#define SPLIT_FIRST_VALUE_39 139
+#define SPLIT_FIRST_VALUE_40 140
+#define SPLIT_FIRST_VALUE_41 141
+#define SPLIT_FIRST_VALUE_42 142
+#define SPLIT_FIRST_VALUE_43 143
+#define SPLIT_FIRST_VALUE_44 144
+#define SPLIT_FIRST_VALUE_45 145
+#define SPLIT_FIRST_VALUE_46 146
+#define SPLIT_FIRST_VALUE_47 147
+
+int split_first(int x);
+
+#define SPLIT_SECOND_VALUE_00 200
+#define SPLIT_SECOND_VALUE_01 201
+#define SPLIT_SECOND_VALUE_02 202
+#define SPLIT_SECOND_VALUE_03 203
+#define SPLIT_SECOND_VALUE_04 204
+#define SPLIT_SECOND_VALUE_05 205
+#define SPLIT_SECOND_VALUE_06 206
+#define SPLIT_SECOND_VALUE_07 207
+#define SPLIT_SECOND_VALUE_08 208
+#define SPLIT_SECOND_VALUE_09 209
+#define SPLIT_SECOND_VALUE_10 210
+#define SPLIT_SECOND_VALUE_11 211
+#define SPLIT_SECOND_VALUE_12 212
+#define SPLIT_SECOND_VALUE_13 213
+#define SPLIT_SECOND_VALUE_14 214
+#define SPLIT_SECOND_VALUE_15 215
+#define SPLIT_SECOND_VALUE_16 216
+#define SPLIT_SECOND_VALUE_17 217
+#define SPLIT_SECOND_VALUE_18 218
+#define SPLIT_SECOND_VALUE_19 219
+#define SPLIT_SECOND_VALUE_20 220
+#define SPLIT_SECOND_VALUE_21 221
+#define SPLIT_SECOND_VALUE_22 222
+#define SPLIT_SECOND_VALUE_23 223
+#define SPLIT_SECOND_VALUE_24 224
+#define SPLIT_SECOND_VALUE_25 225
+#define SPLIT_SECOND_VALUE_26 226
+#define SPLIT_SECOND_VALUE_27 227
+#define SPLIT_SECOND_VALUE_28 228
+#define SPLIT_SECOND_VALUE_29 229
+#define SPLIT_SECOND_VALUE_30 230
+#define SPLIT_SECOND_VALUE_31 231
+#define SPLIT_SECOND_VALUE_32 232
+#define SPLIT_SECOND_VALUE_33 233
+#define SPLIT_SECOND_VALUE_34 234
+#define SPLIT_SECOND_VALUE_35 235
+#define SPLIT_SECOND_VALUE_36 236
+#define SPLIT_SECOND_VALUE_37 237
+#define SPLIT_SECOND_VALUE_38 238
+#define SPLIT_SECOND_VALUE_39 239
+#define SPLIT_SECOND_VALUE_40 240
+#define SPLIT_SECOND_VALUE_41 241
+#define SPLIT_SECOND_VALUE_42 242
+#define SPLIT_SECOND_VALUE_43 243
+#define SPLIT_SECOND_VALUE_44 244
+#define SPLIT_SECOND_VALUE_45 245
+#define SPLIT_SECOND_VALUE_46 246
+#define SPLIT_SECOND_VALUE_47 247
+
+int split_second(int x);
@@ -0,0 +1,17 @@
+# The c2nim options of the test groups. Included by tester.nim and
+# perfgate.nim, so that both translate the test files the same way.
+
+const
+  dotslash = when defined(posix): "./" else: ""
+
+  c2nimOpts = ""
+  cpp2nimOpts = "--cpp"
+  cpp2nimKeepBodiesOpts = "--cpp --keepBodies"
+  hpp2nimOpts = "--cpp --header --cppbindstatic"
+  c2nimExtrasOpts = "--stdints --strict --header --reordercomments --mergeblocks --render:reindentlongcomments --def:RCL_PUBLIC='__attribute__ (())' --def:RCL_WARN_UNUSED='__attribute__ (())' --def:'RCL_ALIGNAS(N)=__attribute__((align))' --render:extranewlines"
+
+proc command(exe, opts: string): string =
+  # the command line for `exe` with `opts`; '$#' is the file to translate:
+  result = dotslash & exe & " "
+  if opts.len > 0: result.add opts & " "
+  result.add "$#"
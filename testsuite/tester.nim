@@ -1,16 +1,25 @@
 # Small program that runs the test cases
 
-import strutils, os, parseopt
+import strutils, os, osproc, parseopt, times, algorithm
 
-const
-  dotslash = when defined(posix): "./" else: ""
+include testcommands
 
-  c2nimCmd = dotslash & "c2nim $#"
-  cpp2nimCmd = dotslash & "c2nim --cpp $#"
-  cpp2nimCmdKeepBodies = dotslash & "c2nim --cpp --keepBodies $#"
-  hpp2nimCmd = dotslash & "c2nim --cpp --header --cppbindstatic $#"
-  c2nimExtrasCmd = dotslash & "c2nim --stdints --strict --header --reordercomments --mergeblocks --render:reindentlongcomments --def:RCL_PUBLIC='__attribute__ (())' --def:RCL_WARN_UNUSED='__attribute__ (())' --def:'RCL_ALIGNAS(N)=__attribute__((align))' --render:extranewlines $#"
+const
+  c2nimCmd = command("c2nim", c2nimOpts)
+  cpp2nimCmd = command("c2nim", cpp2nimOpts)
+  cpp2nimCmdKeepBodies = command("c2nim", cpp2nimKeepBodiesOpts)
+  hpp2nimCmd = command("c2nim", hpp2nimOpts)
+  c2nimExtrasCmd = command("c2nim", c2nimExtrasOpts)
+  c2nimSplitCmd = command("c2nim", "--split:1")
+  c2nimStreamCmd = command("c2nim", "--stream")
+  c2nimParallelCmd = command("c2nim_parallel", "--parallel:4")
+  c2nimParallelExtrasCmd = command("c2nim_parallel",
+                                   "--parallel:4 " & c2nimExtrasOpts)
   dir = "testsuite/"
+  # C headers that are translated again with --stream; the results must be
+  # the same:
+  streamTests = ["enum", "pointerdecls", "struct_anonym", "structdefine",
+                 "tokenconcat"]
   usage = """
 c2nim test runner
 Usage: tester testnames [options]
@@ -20,6 +29,8 @@ Usage: tester testnames [options]
 Options:
   -h --help        Shows this help
   --overwrite      Overwrite the test results with the current results
+  -j:N             Run N tests at a time (default: number of processors)
+  --slowest:N      List the N slowest tests (default: 5)
 """
 
 var
@@ -28,6 +39,8 @@ var
   infiles = newSeq[string](0)
   diffTool = "diff -uNdr"
   overwrite = false
+  jobs = countProcessors()
+  slowest = 5
 
 for kind, key, val in getopt():
   case kind
@@ -42,27 +55,69 @@ for kind, key, val in getopt():
       diffTool = val
     of "overwrite":
       overwrite = true
+    of "j":
+      jobs = parseInt(val)
+    of "slowest":
+      slowest = parseInt(val)
   else:
     stdout.writeLine("[Error] unknown option: " & key)
 
 proc exec(cmd: string) =
   if execShellCmd(cmd) != 0: quit("FAILURE: " & cmd)
 
+type
+  Test = object
+    name, cmd, origin: string
+    start, time: float
+    exitCode: int
+
+var tests: seq[Test] = @[]
+
 proc test(t, cmd, origin: string) =
   let (_, name, _) = splitFile(t)
   if infiles.len() > 0 and not (name in infiles):
     return
-  echo "TEST: ", name
-  exec(cmd % t)
-  let nimFile = name & ".nim"
-  if readFile(dir & origin / nimFile) != readFile(dir & "results" / nimFile):
-    echo "FAILURE: files differ: ", nimFile
-    discard execShellCmd(diffTool & " " & dir & "results" / nimFile & " " & dir & origin / nimFile)
+  tests.add Test(name: name, cmd: cmd % t, origin: origin)
+
+proc check(t: Test) =
+  if t.exitCode != 0:
+    echo "FAILURE: ", t.cmd
     failures += 1
-    if overwrite:
-      copyFile(dir & origin / nimFile, dir & "results" / nimFile)
-  else:
-    echo "SUCCESS: files identical: ", nimFile
+    return
+  # --split writes the modules <name>_partN.nim next to <name>.nim:
+  var nimFiles = @[t.name & ".nim"]
+  for r in walkFiles(dir & "results" / t.name & "_part*.nim"):
+    nimFiles.add extractFilename(r)
+  for nimFile in nimFiles:
+    if readFile(dir & t.origin / nimFile) != readFile(dir & "results" / nimFile):
+      echo "FAILURE: files differ: ", nimFile
+      discard execShellCmd(diffTool & " " & dir & "results" / nimFile & " " & dir & t.origin / nimFile)
+      failures += 1
+      if overwrite:
+        copyFile(dir & t.origin / nimFile, dir & "results" / nimFile)
+    else:
+      echo "SUCCESS: files identical: ", nimFile, " (", formatFloat(t.time, ffDecimal, 3), "s)"
+
+proc runTests() =
+  # runs the translations on `jobs` processes and reports in test order:
+  var cmds = newSeq[string](tests.len)
+  for i, t in tests: cmds[i] = t.cmd
+  proc started(i: int) =
+    tests[i].start = epochTime()
+  proc finished(i: int; p: Process) =
+    tests[i].time = epochTime() - tests[i].start
+    tests[i].exitCode = p.peekExitCode
+  discard execProcesses(cmds, n = max(jobs, 1), beforeRunEvent = started,
+                        afterRunEvent = finished)
+  var total = 0.0
+  for t in tests:
+    echo "TEST: ", t.name
+    check(t)
+    total += t.time
+  let byTime = sorted(tests, proc (a, b: Test): int = cmp(b.time, a.time))
+  echo "translation time: ", formatFloat(total, ffDecimal, 3), "s; slowest:"
+  for t in byTime[0 ..< min(slowest, byTime.len)]:
+    echo "  ", formatFloat(t.time, ffDecimal, 3), "s ", t.name
 
 if not exitEarly:
   exec("nim c c2nim.nim")
@@ -79,5 +134,29 @@ if not exitEarly:
     test(t, cpp2nimCmdKeepBodies, "cppkeepbodies")
   for t in walkFiles(dir & "cextras/*.h"):
     test(t, c2nimExtrasCmd, "cextras")
+  for t in walkFiles(dir & "split/*.h"):
+    test(t, c2nimSplitCmd, "split")
+  createDir(dir & "stream")
+  for name in streamTests:
+    let t = dir & "stream" / name & ".h"
+    copyFile(dir & "tests" / name & ".h", t)
+    test(t, c2nimStreamCmd, "stream")
+
+  when (NimMajor, NimMinor) >= (2, 2):
+    # tiny regions and thresholds, so that the small test files are parsed,
+    # post processed and rendered in parallel; the output must be the same
+    # byte for byte:
+    exec("nim c --threads:on --mm:atomicArc -d:MinRegionSize=64 " &
+         "-d:MinDeclsPerThread=2 -d:MinStmtsPerThread=2 " &
+         "-o:c2nim_parallel c2nim.nim")
+    for t in walkFiles(dir & "parallel/*.h"):
+      test(t, c2nimParallelCmd, "parallel")
+    # the comments are reordered and the blocks merged as without threads:
+    createDir(dir & "parallelextras")
+    for t in walkFiles(dir & "cextras/*.h"):
+      let copy = dir & "parallelextras" / extractFilename(t)
+      copyFile(t, copy)
+      test(copy, c2nimParallelExtrasCmd, "parallelextras")
 
+  runTests()
   if failures > 0: quit($failures & " failures occurred.")
@@ -40,3 +40,25 @@ typedef enum numbers
 	aliasA = one,
 	aliasB = nnine
 };
+
+enum flags
+{
+	f_high = 4 << UNKNOWN_SHIFT,
+	f_low = 1,
+	f_next
+};
+
+enum wide
+{
+	w_wrap = (1 << 40) * (1 << 40) + 1,
+	w_low = -1,
+	w_min = -(-9223372036854775807 - 1)
+};
+
+enum implicit
+{
+	i_zero,
+	i_one,
+	i_two = i_zero + 2,
+	i_lit_two = 2
+};
@@ -0,0 +1,8 @@
+struct flags {
+  int value;
+#define FLAGS_NONE 0
+  int mask;
+};
+
+int flags_set(struct flags *f, int bit);
+int flags_test(struct flags *f, int type);
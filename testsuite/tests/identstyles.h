@@ -0,0 +1,4 @@
+int fooBar(int x);
+int foo_bar(int x);
+int FooBar(int x);
+int foobar(int x);
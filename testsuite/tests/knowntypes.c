@@ -0,0 +1,8 @@
+#typetable
+#knowntype Handle
+
+int close_all(Handle * list, int n) {
+  Handle * it;
+  list * n;
+  return n;
+}
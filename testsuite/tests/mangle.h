@@ -0,0 +1,14 @@
+#mangle "'lib_'{.*}" "$1"
+#mangle "'v'{[0-9]+}'_'{.*}" "$2V$1"
+#mangle "'gl'{.*}" "GL$1"
+
+int lib_v2_open(const char* name);
+int lib_glClear(int mask);
+int v3_close(int fd);
+int glFlush(void);
+int other(int x);
+
+#nomultimangle
+
+int lib_v4_read(int fd);
+int lib_glFinish(void);
@@ -0,0 +1,16 @@
+#prefix "lib_"
+
+int lib_open(int fd);
+int io_open(int fd);
+int hidden_count(void);
+
+#prefix "io_"
+
+int io_open(int fd);
+
+#mangle "'io_'{.*}" "$1Io"
+#private "'hidden_'.*"
+
+int io_open(int fd);
+int lib_read(int fd);
+int hidden_count(void);
@@ -0,0 +1,7 @@
+#mergeDuplicates
+
+int get_value(int the_x);
+int get_value(int theX);
+int get_value(long the_x);
+int set_value(int x);
+int set_value(int x);
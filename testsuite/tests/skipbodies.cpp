@@ -0,0 +1,14 @@
+class Counter {
+public:
+  int limit() const {
+    int big = 100'000;
+    return big;
+  }
+  char brace() const { return '}'; }
+  int size() const {
+#def COUNTER_API
+    return 0;
+  }
+};
+
+COUNTER_API int counter_max();
@@ -0,0 +1,6 @@
+#def VEC(T) vector<T>
+
+VEC(int) make_ints(int n);
+VEC(VEC(int)) nested_ints(int n);
+map<int, VEC(float)> mixed(int n);
+vector<vector<int>> plain(int n);
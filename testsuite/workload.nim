@@ -0,0 +1,209 @@
+# Small program that generates C and C++ headers of a given size and checks
+# how c2nim's time grows with them
+
+import strutils, os, osproc, parseopt, strscans, math, sequtils
+
+const
+  dotslash = when defined(posix): "./" else: ""
+  dir = "testsuite/"
+  usage = """
+c2nim workload generator
+Usage: workload [options]
+  Generates a header with the given number of declarations etc. With
+  --scale it generates headers of several sizes, translates them and fits
+  the growth of every phase of c2nim to a power of the header's size; a
+  phase whose exponent exceeds --limit is reported as super-linear.
+Options:
+  -h --help        Shows this help
+  -o --out:FILE    Write the header to FILE (default: testsuite/workload.h,
+                   or a temporary file for --scale)
+  --cpp            Generate C++ (templates and namespaces)
+  --decls:N        Number of declarations (default: 1000)
+  --depth:N        Nesting depth of structs and templates (default: 3)
+  --macros:N       Number of macros (default: 100)
+  --enumSize:N     Number of fields per enum (default: 20)
+  --ifdefs:P       Percentage of declarations in #ifdef sections (default: 10)
+  --scale:1,2,4,8  Multiply the parameters given by --vary by these factors
+                   and translate every header
+  --vary:decls     The parameters to scale: decls, depth, macros, enumSize
+                   (default: decls)
+  --runs:N         Translate every header N times and keep the fastest run
+                   (default: 3)
+  --limit:X        Largest acceptable growth exponent (default: 1.3)
+  --stream         Translate with c2nim's --stream
+"""
+
+type
+  Workload = object
+    cpp: bool
+    decls, depth, macros, enumSize, ifdefs: int
+
+var
+  exitEarly = false
+  outfile = ""
+  w = Workload(decls: 1000, depth: 3, macros: 100, enumSize: 20, ifdefs: 10)
+  scales: seq[int] = @[]
+  vary = @["decls"]
+  runs = 3
+  limit = 1.3
+  stream = false
+
+for kind, key, val in getopt():
+  case kind
+  of cmdArgument:
+    stdout.writeLine("[Error] unexpected argument: " & key)
+  of cmdLongOption, cmdShortOption:
+    case key.normalize
+    of "help", "h":
+      stdout.write(usage)
+      exitEarly = true
+    of "o", "out": outfile = val
+    of "cpp": w.cpp = true
+    of "decls": w.decls = parseInt(val)
+    of "depth": w.depth = max(parseInt(val), 1)
+    of "macros": w.macros = parseInt(val)
+    of "enumsize": w.enumSize = max(parseInt(val), 1)
+    of "ifdefs": w.ifdefs = parseInt(val)
+    of "scale":
+      for x in val.split(','): scales.add parseInt(x)
+    of "vary": vary = val.split(',')
+    of "runs": runs = max(parseInt(val), 1)
+    of "limit": limit = parseFloat(val)
+    of "stream": stream = true
+    else:
+      stdout.writeLine("[Error] unknown option: " & key)
+  else: discard
+
+proc structDecl(r: var string; name: string; depth: int) =
+  r.add "struct " & name & " {\n"
+  var indent = "  "
+  for d in 1 ..< depth:
+    r.add indent & "int f" & $d & ";\n"
+    r.add indent & "struct {\n"
+    indent.add "  "
+  r.add indent & "unsigned char data[" & $depth & "];\n"
+  for d in countdown(depth-1, 1):
+    indent.setLen(indent.len - 2)
+    r.add indent & "} inner" & $d & ";\n"
+  r.add "};\n"
+
+proc templateType(depth: int): string =
+  result = "int"
+  for d in 1..depth: result = "w_box<" & result & " >"
+
+proc generate(w: Workload): string =
+  ## a header with `w.decls` declarations of various kinds, which use the
+  ## macros and enums that come before them.
+  result = "/* generated by testsuite/workload.nim */\n\n"
+  for i in 0 ..< w.macros:
+    result.add "#define W_MACRO" & $i & "(x) ((x) * " & $(i+1) & " + W_BASE)\n"
+  result.add "#define W_BASE 1\n\n"
+  if w.cpp:
+    result.add "template <typename T> struct w_box { T value; };\n\n"
+    result.add "namespace w {\n\n"
+  for i in 0 ..< w.decls:
+    let guarded = (i * 7919) mod 100 < w.ifdefs
+    if guarded: result.add "#ifdef W_FEATURE" & $(i mod 16) & "\n"
+    case i mod 5
+    of 0:
+      result.add "enum w_enum" & $i & " {\n"
+      for k in 0 ..< w.enumSize:
+        result.add "  W_E" & $i & "_" & $k
+        if w.macros > 0 and k mod 4 == 3:
+          result.add " = W_MACRO" & $(k mod w.macros) & "(" & $k & ")"
+        result.add ",\n"
+      result.add "};\n"
+    of 1:
+      structDecl(result, "w_struct" & $i, w.depth)
+    of 2:
+      result.add "typedef struct w_struct" & $(i-1) & " *w_handle" & $i & ";\n"
+    of 3:
+      if w.cpp:
+        result.add templateType(w.depth) & " w_fn" & $i & "(" &
+                   templateType(w.depth - 1) & " a, w_handle" & $(i-1) &
+                   " h);\n"
+      else:
+        result.add "int w_fn" & $i & "(int a, w_handle" & $(i-1) &
+                   " h, const char *fmt, ...);\n"
+    else:
+      if w.macros > 0:
+        result.add "#define W_CONST" & $i & " W_MACRO" & $(i mod w.macros) &
+                   "(" & $i & ")\n"
+      result.add "extern int w_var" & $i & "[" & $(i mod 16 + 1) & "];\n"
+    if guarded: result.add "#endif\n"
+  if w.cpp: result.add "\n}\n"
+
+proc slope(xs, ys: seq[float]): float =
+  # least squares fit of log(y) = a + slope * log(x):
+  var sx, sy, sxx, sxy = 0.0
+  for i in 0 ..< xs.len:
+    let x = ln(xs[i])
+    let y = ln(max(ys[i], 1e-6))
+    sx += x
+    sy += y
+    sxx += x * x
+    sxy += x * y
+  let n = xs.len.float
+  result = (n * sxy - sx * sy) / (n * sxx - sx * sx)
+
+proc measure(file: string; cpp: bool): seq[float] =
+  # the fastest of `runs` translations: total, parse, postprocess, render
+  result = @[Inf, Inf, Inf, Inf]
+  let cmd = dotslash & "c2nim --stats " & (if cpp: "--cpp " else: "") &
+            (if stream: "--stream " else: "") & file
+  for r in 1..runs:
+    let (output, exitCode) = execCmdEx(cmd)
+    if exitCode != 0: quit("FAILURE: " & cmd)
+    var lineCount, tokens, backtracks, maxmem: int
+    var t: array[4, float]
+    for line in splitLines(output):
+      if scanf(line, "stats: lines=$i tokens=$i backtracks=$i maxmem=$i " &
+               "time=$f parse=$f postprocess=$f render=$f", lineCount, tokens,
+               backtracks, maxmem, t[0], t[1], t[2], t[3]):
+        for k in 0..3: result[k] = min(result[k], t[k])
+  if result[0] == Inf: quit("FAILURE: no stats line: " & cmd)
+
+if not exitEarly:
+  let ext = if w.cpp: ".hpp" else: ".h"
+  if scales.len == 0:
+    writeFile(if outfile.len > 0: outfile else: dir & "workload" & ext,
+              generate(w))
+  elif scales.len < 2:
+    quit("[Error] --scale needs at least two factors")
+  elif deduplicate(scales).len < scales.len:
+    # the fit needs different sizes:
+    quit("[Error] --scale has duplicate factors")
+  else:
+    if outfile.len == 0: outfile = getTempDir() / "c2nim_workload" & ext
+    if execShellCmd("nim c -d:release c2nim.nim") != 0:
+      quit("FAILURE: nim c -d:release c2nim.nim")
+    const phases = ["total", "parse", "postprocess", "render"]
+    var xs: seq[float] = @[]
+    var times: seq[seq[float]] = @[]
+    for k in scales:
+      var s = w
+      for v in vary:
+        case v.normalize
+        of "decls": s.decls = w.decls * k
+        of "depth": s.depth = w.depth * k
+        of "macros": s.macros = w.macros * k
+        of "enumsize": s.enumSize = w.enumSize * k
+        else: quit("[Error] unknown parameter: " & v)
+      let header = generate(s)
+      writeFile(outfile, header)
+      let t = measure(outfile, w.cpp)
+      echo "SCALE: ", k, " ", header.len, " bytes ",
+           formatFloat(t[0], ffDecimal, 3), "s"
+      xs.add header.len.float
+      times.add t
+    var failures = 0
+    for p in 0 ..< phases.len:
+      var ys: seq[float] = @[]
+      for t in times: ys.add t[p]
+      let e = slope(xs, ys)
+      if e > limit:
+        echo "FAILURE: ", phases[p], " grows like n^", formatFloat(e, ffDecimal, 2)
+        inc failures
+      else:
+        echo "SUCCESS: ", phases[p], " grows like n^", formatFloat(e, ffDecimal, 2)
+    if failures > 0: quit($failures & " phases are super-linear.")
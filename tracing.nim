@@ -0,0 +1,99 @@
+#
+#
+#      c2nim - C to Nim source converter
+#        (c) Copyright 2015 Andreas Rumpf
+#
+#    See the file "copying.txt", included in this
+#    distribution, for details about the copyright.
+#
+
+## Records the spans of a translation run for ``--trace:FILE`` and writes
+## them in Chrome's trace event format. Load the file in ``chrome://tracing``
+## or Perfetto to see a timeline.
+
+import std / [times, json, strutils]
+import compiler / ast
+
+when compileOption("threads"):
+  import locks
+
+type
+  TraceEvent = object
+    name, cat: string
+    start, dur: float # in microseconds
+    tid: int
+
+var
+  gTracing*: bool ## record spans?
+  events: seq[TraceEvent]
+  traceStart = epochTime()
+
+when compileOption("threads"):
+  # the regions of a file are parsed on several threads:
+  var eventsLock: Lock
+  initLock(eventsLock)
+
+proc traceNow*(): float =
+  ## the start of a span for `traceSpan`; 0 unless tracing.
+  if gTracing: result = (epochTime() - traceStart) * 1e6
+  else: result = 0.0
+
+proc traceSpan*(name, cat: string; start: float) =
+  ## records the span from `start` until now.
+  var e = TraceEvent(name: name, cat: cat, start: start,
+                     dur: traceNow() - start)
+  when compileOption("threads"):
+    e.tid = getThreadId()
+    withLock(eventsLock): events.add e
+  else:
+    events.add e
+
+proc traceMark*(): int =
+  ## the number of spans recorded so far; for `traceDiscard`.
+  when compileOption("threads"):
+    withLock(eventsLock): result = events.len
+  else:
+    result = events.len
+
+proc traceDiscard*(mark: int) =
+  ## drops the spans recorded since `traceMark` returned `mark`, for work
+  ## that is thrown away and done again.
+  when compileOption("threads"):
+    withLock(eventsLock): setLen(events, mark)
+  else:
+    setLen(events, mark)
+
+template traced*(name, cat: string; body: untyped) =
+  ## records `body` as a span if tracing is on.
+  let start = traceNow()
+  body
+  if gTracing: traceSpan(name, cat, start)
+
+proc declLabel*(n: PNode): string =
+  ## a label for a top level declaration: its kind and its name.
+  var n = n
+  while n.kind == nkStmtList and n.len > 0: n = n[0]
+  result = substr($n.kind, 2)
+  if n.kind in {nkTypeSection, nkVarSection, nkLetSection, nkConstSection} and
+      n.len > 0:
+    n = n[0]
+  if n.kind in {nkProcDef, nkFuncDef, nkMethodDef, nkConverterDef,
+                nkIteratorDef, nkTemplateDef, nkMacroDef, nkTypeDef,
+                nkIdentDefs, nkConstDef} and n.len > 0:
+    n = n[0]
+  if n.kind == nkPragmaExpr and n.len > 0: n = n[0]
+  if n.kind == nkPostfix and n.len > 1: n = n[1]
+  if n.kind == nkIdent: result.add " " & n.ident.s
+
+proc writeTrace*(filename: string) =
+  ## writes the recorded spans to `filename`.
+  var f = open(filename, fmWrite)
+  f.write "{\"traceEvents\": [\n"
+  for i, e in events:
+    if i > 0: f.write ",\n"
+    f.write "{\"name\": ", escapeJson(e.name), ", \"cat\": ", escapeJson(e.cat),
+      ", \"ph\": \"X\", \"ts\": ", formatFloat(e.start, ffDecimal, 1),
+      ", \"dur\": ", formatFloat(e.dur, ffDecimal, 1),
+      ", \"pid\": 1, \"tid\": ", e.tid, "}"
+  f.write "\n], \"displayTimeUnit\": \"ms\"}\n"
+  f.close